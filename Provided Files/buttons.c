@@ -5,23 +5,27 @@
  */ 
 
 #include "buttons.h"
+#include "input.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "profile.h"
 
 // Global variable to keep track of the last button state so that we 
 // can detect changes when an interrupt fires. The lower 4 bits (0 to 3)
-// will correspond to the last state of port B pins 0 to 3.
+// will correspond to the last state of port B pins 0 to 3. This is the
+// debounced state - the state last queued as an event.
 static volatile uint8_t last_button_state;
 
-// Our button queue. button_queue[0] is always the head of the queue. If we
-// take something off the queue we just move everything else along. We don't
-// use a circular buffer since it is usually expected that the queue is very
-// short. In most uses it will never have more than 1 element at a time.
-// This button queue can be changed by the interrupt handler below so we should
-// turn off interrupts if we're changing the queue outside the handler.
-#define BUTTON_QUEUE_SIZE 4
-static volatile uint8_t button_queue[BUTTON_QUEUE_SIZE];
-static volatile int8_t queue_length;
+// Debouncing. After a pin's state changes, further changes on that pin are
+// ignored for BUTTON_DEBOUNCE_MS milliseconds while its contacts settle.
+// The debouncing variable has a bit set for each pin in this lockout, and
+// debounce_ms_left counts down the milliseconds left for each pin. The
+// countdown is run from the timer 0 interrupt by button_debounce_tick().
+static volatile uint8_t debouncing;
+static volatile uint8_t debounce_ms_left[NUM_BUTTONS];
+
+// Button pushes and releases are added to the input event queue (see
+// input.h), which is shared with the serial keys.
 
 // Setup interrupt if any of pins B0 to B3 change. We do this
 // using a pin change interrupt. These pins correspond to pin
@@ -40,65 +44,87 @@ void init_button_interrupts(void)
 	// the relevant bits in the mask register (see datasheet page 78)
 	PCMSK1 |= (1 << PCINT8) | (1 << PCINT9) | (1 << PCINT10) | (1 << PCINT11);	
 	
-	// Empty the button push queue
-	queue_length = 0;
+	// Empty the input event queue, and start with no buttons settling
+	init_input();
+	debouncing = 0;
 }
 
 int8_t button_pushed(void)
 {
-	int8_t return_value = NO_BUTTON_PUSHED;	// Assume no button pushed
-
-	if (queue_length > 0)
+	// Take events off the queue until we find a button push. Releases
+	// (and any serial key events) are discarded.
+	InputEvent event;
+	while (input_next_event(&event))
 	{
-		// Remove the first element off the queue and move all the other
-		// entries closer to the front of the queue. We turn off interrupts (if on)
-		// before we make any changes to the queue. If interrupts were on
-		// we turn them back on when done.
-		return_value = button_queue[0];
-		
-		// Save whether interrupts were enabled and turn them off
-		int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
-		cli();
-		
-		for (uint8_t i = 1; i < queue_length; i++)
+		if (event.source == INPUT_BUTTON && event.pressed)
 		{
-			button_queue[i - 1] = button_queue[i];
-		}
-		queue_length--;
-		
-		if (interrupts_were_enabled)
-		{
-			// Turn them back on again
-			sei();
+			return event.lane;
 		}
 	}
-	return return_value;
+	return NO_BUTTON_PUSHED;
 }
 
 // Interrupt handler for a change on buttons
 ISR(PCINT1_vect)
 {
+	PROFILE_ISR_START();
 	// Get the current state of the buttons. We'll compare this with
 	// the last state to see what has changed.
 	uint8_t button_state = PINB & 0x0F;
 	
-	// Iterate over all the buttons and see which ones have changed.
-	// Any button pushes are added to the queue of button pushes (if
-	// there is space). We ignore button releases so we're just looking
-	// for a transition from 0 in the last_button_state bit to a 1 in the 
-	// button_state.
+	// Find the buttons which have changed, ignoring any which are still
+	// settling after their last change.
+	uint8_t changed = (button_state ^ last_button_state) & ~debouncing;
+	
+	// Each push (a transition from 0 in the last_button_state bit to a 1
+	// in the button_state) or release is added to the input event queue.
+	// This is the first edge, so it is timestamped with when the button
+	// was actually pushed or released, not when the bouncing stopped.
 	for (uint8_t pin = 0; pin < NUM_BUTTONS; pin++)
 	{
-		if (queue_length < BUTTON_QUEUE_SIZE
-				&& (button_state & (1 << pin))
-				&& !(last_button_state & (1 << pin)))
-				{
-			// Add the button push to the queue (and update the
-			// length of the queue
-			button_queue[queue_length++] = pin;
+		uint8_t mask = 1 << pin;
+		if (changed & mask)
+		{
+			input_add_event(INPUT_BUTTON, pin, (button_state & mask) != 0);
+			debounce_ms_left[pin] = BUTTON_DEBOUNCE_MS;
 		}
 	}
 	
-	// Remember this button state
-	last_button_state = button_state;
+	// Remember this button state, and start the lockout for each button
+	// which changed.
+	last_button_state ^= changed;
+	if (BUTTON_DEBOUNCE_MS > 0)
+	{
+		debouncing |= changed;
+	}
+	PROFILE_ISR_END(PROFILE_PCINT1);
+}
+
+void button_debounce_tick(void)
+{
+	if (!debouncing)
+	{
+		return;
+	}
+	
+	// Count down each lockout. When one ends the pin is read again, since
+	// any changes during the lockout were ignored - if it was released
+	// while bouncing we would otherwise never see the release. A change
+	// found here is queued and starts a new lockout.
+	uint8_t button_state = PINB & 0x0F;
+	for (uint8_t pin = 0; pin < NUM_BUTTONS; pin++)
+	{
+		uint8_t mask = 1 << pin;
+		if ((debouncing & mask) && --debounce_ms_left[pin] == 0)
+		{
+			debouncing &= ~mask;
+			if ((button_state ^ last_button_state) & mask)
+			{
+				input_add_event(INPUT_BUTTON, pin, (button_state & mask) != 0);
+				last_button_state ^= mask;
+				debounce_ms_left[pin] = BUTTON_DEBOUNCE_MS;
+				debouncing |= mask;
+			}
+		}
+	}
 }
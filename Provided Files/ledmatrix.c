@@ -26,14 +26,19 @@ void ledmatrix_setup(void)
 	spi_setup_master(128);
 }
 
+void ledmatrix_flush_wait(void)
+{
+	spi_wait_until_sent();
+}
+
 void ledmatrix_update_all(MatrixData data)
 {
-	(void)spi_send_byte(CMD_UPDATE_ALL);
+	spi_queue_byte(CMD_UPDATE_ALL);
 	for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
 	{
 		for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
 		{
-			(void)spi_send_byte(data[x][y]);
+			spi_queue_byte(data[x][y]);
 		}
 	}
 }
@@ -45,9 +50,9 @@ void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel)
 		// Position isn't valid - we ignore the request.
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_PIXEL);
-	(void)spi_send_byte(((y & 0x07) << 4) | (x & 0x0F));
-	(void)spi_send_byte(pixel);
+	spi_queue_byte(CMD_UPDATE_PIXEL);
+	spi_queue_byte(((y & 0x07) << 4) | (x & 0x0F));
+	spi_queue_byte(pixel);
 }
 
 void ledmatrix_update_row(uint8_t y, MatrixRow row)
@@ -57,11 +62,11 @@ void ledmatrix_update_row(uint8_t y, MatrixRow row)
 		// y value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_ROW);
-	(void)spi_send_byte(y & 0x07);	// row number
+	spi_queue_byte(CMD_UPDATE_ROW);
+	spi_queue_byte(y & 0x07);	// row number
 	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
 	{
-		(void)spi_send_byte(row[x]);
+		spi_queue_byte(row[x]);
 	}
 }
 
@@ -72,41 +77,41 @@ void ledmatrix_update_column(uint8_t x, MatrixColumn col)
 		// x value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_COL);
-	(void)spi_send_byte(x & 0x0F); // column number
+	spi_queue_byte(CMD_UPDATE_COL);
+	spi_queue_byte(x & 0x0F); // column number
 	for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
 	{
-		(void)spi_send_byte(col[y]);
+		spi_queue_byte(col[y]);
 	}
 }
 
 void ledmatrix_shift_display_left(void)
 {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x02);
+	spi_queue_byte(CMD_SHIFT_DISPLAY);
+	spi_queue_byte(0x02);
 }
 
 void ledmatrix_shift_display_right(void)
 {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x01);
+	spi_queue_byte(CMD_SHIFT_DISPLAY);
+	spi_queue_byte(0x01);
 }
 
 void ledmatrix_shift_display_up(void)
 {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x08);
+	spi_queue_byte(CMD_SHIFT_DISPLAY);
+	spi_queue_byte(0x08);
 }
 
 void ledmatrix_shift_display_down(void)
 {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x04);
+	spi_queue_byte(CMD_SHIFT_DISPLAY);
+	spi_queue_byte(0x04);
 }
 
 void ledmatrix_clear(void)
 {
-	(void)spi_send_byte(CMD_CLEAR_SCREEN);
+	spi_queue_byte(CMD_CLEAR_SCREEN);
 }
 
 void copy_matrix_column(MatrixColumn from, MatrixColumn to)
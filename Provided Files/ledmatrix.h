@@ -26,6 +26,11 @@ typedef PixelColour MatrixColumn[MATRIX_NUM_ROWS];
 // below are used.
 void ledmatrix_setup(void);
 
+// Wait until all updates sent to the display have reached it.
+// The update functions below queue their SPI bytes and return straight
+// away - the bytes are sent in the background by the SPI interrupt.
+void ledmatrix_flush_wait(void);
+
 // Functions to update the display
 // For those functions which take an x or a y value, the value must be valid
 // or the request will be ignored. (i.e. x must be < MATRIX_NUM_COLUMNS
@@ -12,6 +12,10 @@
  * put method will either
  * (1) if interrupts are enabled, block until there is room in it, or
  * (2) if interrupts are disabled, will discard the character.
+ * Output sent through stdio is critical - it is never dropped. Cosmetic
+ * output (see serial_write_cosmetic()) never blocks: a cosmetic message
+ * is queued whole or not at all, and is refused unless it leaves
+ * CRITICAL_OUTPUT_RESERVE bytes free in the buffer for critical output.
  * Input is blocking - requesting input from stdin will block
  * until a character is available. If interrupts are disabled when 
  * input is sought, then this will block forever.
@@ -23,8 +27,13 @@
 #include "serialio.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "hal.h"
+#include "profile.h"
 
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
@@ -46,6 +55,27 @@ volatile char out_buffer[OUTPUT_BUFFER_SIZE];
 volatile uint8_t out_insert_pos;
 volatile uint8_t bytes_in_out_buffer;
 
+/* Number of bytes of the output buffer that cosmetic output may not use,
+ * so that critical output queued behind it doesn't have to wait.
+ */
+#define CRITICAL_OUTPUT_RESERVE 64
+
+/* Longest cosmetic message that serial_printf_cosmetic_P() can format
+ * (including the terminating null).
+ */
+#define COSMETIC_MESSAGE_SIZE 32
+
+/* Counts of cosmetic bytes which were given up on, of cosmetic messages
+ * which were refused and kept to try again (once each, however many tries
+ * they take) and of critical bytes which had to wait for space in the
+ * output buffer. All wrap around. (None is changed by an ISR
+ * - the echo in the receive ISR runs with interrupts off, so it never
+ * waits.)
+ */
+static uint16_t dropped_bytes;
+static uint16_t refused_messages;
+static uint16_t deferred_bytes;
+
 /* Circular buffer to hold incoming characters. Works on same principle
  * as output buffer
  */
@@ -60,21 +90,35 @@ volatile uint8_t input_overrun;
  */
 static int8_t do_echo;
 
+/* Function each received character is offered to before it is put in the
+ * input buffer (see serial_set_input_hook()), or 0 if there is none.
+ */
+static int8_t (*volatile input_hook)(char);
+
+/* The baud rate the UART is actually running at, and how far that is from
+ * the rate asked for, in tenths of a percent.
+ */
+static long actual_baudrate;
+static int16_t baudrate_error;
+
 /* Function prototypes 
  */
 void init_serial_stdio(long baudrate, int8_t echo);
+static void set_baud_rate(long baudrate);
 static int uart_put_char(char, FILE*);
 static int uart_get_char(FILE*);
 
 /* Setup a stream that uses the uart get and put functions. We will
- * make standard input and output use this stream below.
+ * make standard input and output use this stream below. (The host build
+ * has no FDEV_SETUP_STREAM - it makes its streams in serialio_host.c.)
  */
+#ifndef HOST_BUILD
 static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
 		_FDEV_SETUP_RW);
+#endif
 
 void init_serial_stdio(long baudrate, int8_t echo)
 {
-	uint16_t ubrr;
 	/*
 	 * Initialise our buffers
 	*/
@@ -83,6 +127,9 @@ void init_serial_stdio(long baudrate, int8_t echo)
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
 	input_overrun = 0;
+	dropped_bytes = 0;
+	refused_messages = 0;
+	deferred_bytes = 0;
 	
 	/*
 	 * Record whether we're going to echo characters or not
@@ -90,12 +137,7 @@ void init_serial_stdio(long baudrate, int8_t echo)
 	do_echo = echo;
 	
 	/* Configure the serial port baud rate */
-	/* (This differs from the datasheet formula so that we get 
-	 * rounding to the nearest integer while using integer division
-	 * (which truncates)).
-	*/
-	ubrr = (((SYSCLK / (8 * baudrate)) + 1) / 2) - 1;
-	UBRR0 = ubrr;
+	set_baud_rate(baudrate);
 	
 	/*
 	 * Enable transmission and receiving via UART. We don't enable
@@ -115,8 +157,71 @@ void init_serial_stdio(long baudrate, int8_t echo)
 	 * to write/read characters via the serial port when we use
 	 * stdio functions
 	*/
+#ifdef HOST_BUILD
+	host_serial_open_streams(uart_put_char, uart_get_char);
+#else
 	stdout = &myStream;
 	stdin = &myStream;
+#endif
+}
+
+/* Returns the UBRR value which gives the closest rate to the given baud
+ * rate, for a UART clock of SYSCLK/divisor (16 in normal mode, 8 in double
+ * speed mode).
+ */
+static uint16_t closest_ubrr(long baudrate, uint8_t divisor)
+{
+	/* (This differs from the datasheet formula so that we get 
+	 * rounding to the nearest integer while using integer division
+	 * (which truncates)).
+	*/
+	long ubrr = (((SYSCLK / ((divisor / 2) * baudrate)) + 1) / 2) - 1;
+	if (ubrr < 0)
+	{
+		/* Faster than the UART can go - use the fastest rate */
+		ubrr = 0;
+	}
+	else if (ubrr > 4095)
+	{
+		/* UBRR0 is only 12 bits */
+		ubrr = 4095;
+	}
+	return ubrr;
+}
+
+/* Configure the UART for the given baud rate, using double speed (U2X)
+ * mode if that gets closer to it. Normal mode is used if both are equally
+ * close since the receiver is more tolerant of timing errors in normal mode.
+ */
+static void set_baud_rate(long baudrate)
+{
+	uint16_t normal_ubrr = closest_ubrr(baudrate, 16);
+	uint16_t double_ubrr = closest_ubrr(baudrate, 8);
+	long normal_rate = SYSCLK / (16 * (normal_ubrr + 1L));
+	long double_rate = SYSCLK / (8 * (double_ubrr + 1L));
+	
+	if (labs(double_rate - baudrate) < labs(normal_rate - baudrate))
+	{
+		UCSR0A |= (1 << U2X0);
+		UBRR0 = double_ubrr;
+		actual_baudrate = double_rate;
+	} else
+	{
+		UCSR0A &= ~(1 << U2X0);
+		UBRR0 = normal_ubrr;
+		actual_baudrate = normal_rate;
+	}
+	baudrate_error = ((actual_baudrate - baudrate) * 1000) / baudrate;
+}
+
+long serial_actual_baudrate(void)
+{
+	return actual_baudrate;
+}
+
+int16_t serial_baudrate_error(void)
+{
+	return baudrate_error;
 }
 
 int8_t serial_input_available(void)
@@ -124,6 +229,11 @@ int8_t serial_input_available(void)
 	return bytes_in_input_buffer != 0;
 }
 
+void serial_set_input_hook(int8_t (*hook)(char))
+{
+	input_hook = hook;
+}
+
 void clear_serial_input_buffer(void)
 {
 	/* Just adjust our buffer data so it looks empty */
@@ -153,13 +263,18 @@ static int uart_put_char(char c, FILE* stream)
 	 * ISR which extracts bytes from the buffer.
 	*/
 	interrupts_enabled = bit_is_set(SREG, SREG_I);
+	if (bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE && interrupts_enabled)
+	{
+		deferred_bytes++;
+	}
 	while (bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE)
 	{
 		if (!interrupts_enabled)
 		{
 			return 1;
 		}		
-		/* else do nothing */
+		/* else wait for the ISR */
+		hal_idle();
 	}
 	
 	/* Add the character to the buffer for transmission if there
@@ -190,12 +305,100 @@ static int uart_put_char(char c, FILE* stream)
 	return 0;
 }
 
+int8_t serial_write_cosmetic(const char* data, uint8_t length)
+{
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	
+	/* Refuse the whole message if it would eat into the space kept for
+	 * critical output. Part of a message (e.g. half an escape sequence)
+	 * would be worse than none of it.
+	 */
+	if (OUTPUT_BUFFER_SIZE - bytes_in_out_buffer
+			< length + CRITICAL_OUTPUT_RESERVE)
+	{
+		if (interrupts_enabled)
+		{
+			sei();
+		}
+		return 0;
+	}
+	
+	/* There is room - copy the message in with interrupts off so that
+	 * nothing else is queued in the middle of it.
+	 */
+	for (uint8_t i = 0; i < length; i++)
+	{
+		out_buffer[out_insert_pos++] = data[i];
+		if (out_insert_pos == OUTPUT_BUFFER_SIZE)
+		{
+			out_insert_pos = 0;
+		}
+	}
+	bytes_in_out_buffer += length;
+	UCSR0B |= (1 << UDRIE0);
+	if (interrupts_enabled)
+	{
+		sei();
+	}
+	return 1;
+}
+
+int8_t serial_printf_cosmetic_P(const char* format, ...)
+{
+	static char message[COSMETIC_MESSAGE_SIZE];
+	va_list args;
+	
+	va_start(args, format);
+	int length = vsnprintf_P(message, sizeof(message), format, args);
+	va_end(args);
+	if (length < 0)
+	{
+		return 0;
+	}
+	if (length >= (int)sizeof(message))
+	{
+		/* Message was truncated */
+		length = sizeof(message) - 1;
+	}
+	
+	/* The message is overwritten by the next call, so if it is refused
+	 * it is gone for good.
+	 */
+	if (!serial_write_cosmetic(message, length))
+	{
+		dropped_bytes += length;
+		return 0;
+	}
+	return 1;
+}
+
+uint16_t serial_dropped_bytes(void)
+{
+	return dropped_bytes;
+}
+
+void serial_count_refused_message(void)
+{
+	refused_messages++;
+}
+
+uint16_t serial_refused_messages(void)
+{
+	return refused_messages;
+}
+
+uint16_t serial_deferred_bytes(void)
+{
+	return deferred_bytes;
+}
+
 int uart_get_char(FILE* stream)
 {
 	/* Wait until we've received a character */
 	while (bytes_in_input_buffer == 0)
 	{
-		/* do nothing */
+		hal_idle();
 	}
 	
 	/*
@@ -233,6 +436,7 @@ int uart_get_char(FILE* stream)
  */
 ISR(USART0_UDRE_vect) 
 {
+	PROFILE_ISR_START();
 	/* Check if we have data in our buffer */
 	if (bytes_in_out_buffer > 0)
 	{
@@ -269,6 +473,7 @@ ISR(USART0_UDRE_vect)
 		 */
 		UCSR0B &= ~(1 << UDRIE0);
 	}
+	PROFILE_ISR_END(PROFILE_USART0_UDRE);
 }
 
 /*
@@ -279,9 +484,17 @@ ISR(USART0_UDRE_vect)
 
 ISR(USART0_RX_vect) 
 {
+	PROFILE_ISR_START();
 	/* Read the character - we ignore the possibility of overrun. */
 	char c;
 	c = UDR0;
+	
+	/* If the hook takes the character it goes no further */
+	if (input_hook && input_hook(c))
+	{
+		PROFILE_ISR_END(PROFILE_USART0_RX);
+		return;
+	}
 		
 	if (do_echo && bytes_in_out_buffer < OUTPUT_BUFFER_SIZE)
 	{
@@ -323,4 +536,5 @@ ISR(USART0_RX_vect)
 			input_insert_pos = 0;
 		}
 	}
+	PROFILE_ISR_END(PROFILE_USART0_RX);
 }
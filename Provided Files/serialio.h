@@ -21,10 +21,19 @@
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baud rate (e.g. 19200) and echo determines whether incoming characters
  * are echoed back to the UART output as they are received (zero means no
- * echo, non-zero means echo)
+ * echo, non-zero means echo). The UART's normal or double speed mode is
+ * chosen, whichever gets closer to the desired rate. At 8MHz, rates of
+ * 250000, 500000 and 1000000 baud are exact.
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 
+/* The baud rate the UART is actually running at, and its error from the
+ * rate given to init_serial_stdio() in tenths of a percent (e.g. 2 means
+ * 0.2% fast). Errors beyond about 2% are likely to garble the output.
+ */
+long serial_actual_baudrate(void);
+int16_t serial_baudrate_error(void);
+
 /* Test if input is available from the serial port. Return 0 if not,
  * non-zero otherwise. If there is input available then it can be read
  * with a suitable standard IO library function, e.g. fgetc().
@@ -36,5 +45,44 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Set a function to be called from the receive interrupt handler with
+ * each character received, before it is echoed or put in the input buffer.
+ * If the function returns non-zero the character is taken by it and goes
+ * no further. Pass 0 to remove the hook. The function runs with interrupts
+ * off and must be short.
+ */
+void serial_set_input_hook(int8_t (*hook)(char));
+
+/* Queue cosmetic output (banners, debug text) without blocking. The
+ * message is either queued whole or refused, and is refused if queueing it
+ * would leave less than a reserved amount of the output buffer free for
+ * critical output (anything sent through stdio). No newline translation
+ * is done. Returns 1 if the message was queued, 0 if it was refused - the
+ * caller still has the message and may try again later.
+ */
+int8_t serial_write_cosmetic(const char* data, uint8_t length);
+
+/* As above, but formats a short message (up to 31 characters, any more
+ * are cut off) with a format string in program memory, as for printf_P().
+ * The message isn't kept, so if it is refused it is dropped.
+ */
+int8_t serial_printf_cosmetic_P(const char* format, ...);
+
+/* Count a cosmetic message which serial_write_cosmetic() refused and the
+ * caller has kept to try again. Call it on the first refusal only, so
+ * that a message counts once however many tries it takes.
+ */
+void serial_count_refused_message(void);
+
+/* Since init_serial_stdio(): the number of cosmetic bytes dropped for
+ * good, the number of cosmetic messages refused and kept to try again
+ * (see above), and the number of critical bytes which had to wait for
+ * space in the output buffer. These show how often the serial link
+ * saturates. All wrap around at 65536.
+ */
+uint16_t serial_dropped_bytes(void);
+uint16_t serial_refused_messages(void);
+uint16_t serial_deferred_bytes(void);
+
 
 #endif /* SERIALIO_H_ */
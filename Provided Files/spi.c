@@ -6,6 +6,24 @@
 
 #include "spi.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include "profile.h"
+
+// Circular buffer of bytes waiting to be sent. Bytes are taken from
+// queue_head and added at queue_tail; the queue is empty when the two are
+// equal. The size must be a power of two no larger than 128 (one position
+// is always left empty so that a full queue can be told apart from an
+// empty one). transfer_in_progress is set while a byte is being shifted
+// out - when it is clear the next byte can be written straight to SPDR0.
+#define SPI_QUEUE_SIZE 128
+#define SPI_QUEUE_MASK (SPI_QUEUE_SIZE - 1)
+static volatile uint8_t spi_queue[SPI_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile uint8_t transfer_in_progress;
+
+static void start_next_transfer(void);
+static void wait_for_transfer(void);
 
 void spi_setup_master(uint8_t clockdivider)
 {
@@ -20,7 +38,13 @@ void spi_setup_master(uint8_t clockdivider)
 	// Set up the SPI control registers SPCR and SPSR:
 	// - SPE bit = 1 (SPI is enabled)
 	// - MSTR bit = 1 (Master Mode)
-	SPCR0 = (1 << SPE0) | (1 << MSTR0);
+	// - SPIE bit = 1 (transfer complete interrupt, which sends the queue)
+	SPCR0 = (1 << SPE0) | (1 << MSTR0) | (1 << SPIE0);
+	
+	// Empty the transmit queue
+	queue_head = 0;
+	queue_tail = 0;
+	transfer_in_progress = 0;
 	
 	// Set SPR0 and SPR1 bits in SPCR and SPI2X bit in SPSR
 	// based on the given clock divider
@@ -58,6 +82,14 @@ void spi_setup_master(uint8_t clockdivider)
 
 uint8_t spi_send_byte(uint8_t byte)
 {
+	uint8_t received;
+	
+	// Let the queue drain first so bytes go out in order. The transfer
+	// complete interrupt is turned off while we send this byte, otherwise
+	// it would clear the SPIF0 flag before we could see it.
+	spi_wait_until_sent();
+	SPCR0 &= ~(1 << SPIE0);
+	
 	// Write out the byte to the SPDR0 register. This will initiate
 	// the transfer. We then wait until the most significant byte of
 	// SPSR0 (SPIF0 bit) is set - this indicates that the transfer is
@@ -69,5 +101,91 @@ uint8_t spi_send_byte(uint8_t byte)
 	{
 		; // wait
 	}
-	return SPDR0;
+	received = SPDR0;
+	SPCR0 |= (1 << SPIE0);
+	return received;
+}
+
+void spi_queue_byte(uint8_t byte)
+{
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	
+	// Wait for space in the queue. The interrupt handler makes room as
+	// bytes are sent - if interrupts are off we have to send them here.
+	while (((queue_tail + 1) & SPI_QUEUE_MASK) == queue_head)
+	{
+		if (!interrupts_were_enabled)
+		{
+			wait_for_transfer();
+		}
+	}
+	
+	// If nothing is being sent, start sending this byte straight away,
+	// otherwise add it to the end of the queue. Interrupts are turned off
+	// so the interrupt handler can't finish a transfer part way through.
+	cli();
+	if (transfer_in_progress)
+	{
+		spi_queue[queue_tail] = byte;
+		queue_tail = (queue_tail + 1) & SPI_QUEUE_MASK;
+	}
+	else
+	{
+		transfer_in_progress = 1;
+		SPDR0 = byte;
+	}
+	if (interrupts_were_enabled)
+	{
+		sei();
+	}
+}
+
+void spi_wait_until_sent(void)
+{
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	while (transfer_in_progress)
+	{
+		if (!interrupts_were_enabled)
+		{
+			wait_for_transfer();
+		}
+	}
+}
+
+// Start sending the next queued byte, if there is one. Must be called
+// with interrupts off, once the previous transfer is complete.
+static void start_next_transfer(void)
+{
+	if (queue_head != queue_tail)
+	{
+		SPDR0 = spi_queue[queue_head];
+		queue_head = (queue_head + 1) & SPI_QUEUE_MASK;
+	}
+	else
+	{
+		transfer_in_progress = 0;
+	}
+}
+
+// Busy wait for the byte being sent to finish and then start the next
+// one. Used in place of the interrupt handler when interrupts are off.
+static void wait_for_transfer(void)
+{
+	while ((SPSR0 & (1 << SPIF0)) == 0)
+	{
+		; // wait
+	}
+	// Reading SPDR0 after SPSR0 clears SPIF0, so the interrupt handler
+	// won't also run for this transfer once interrupts are back on.
+	(void)SPDR0;
+	start_next_transfer();
+}
+
+// Interrupt handler for SPI transfer complete. The flag is cleared by
+// the hardware when the handler runs.
+ISR(SPI_STC_vect)
+{
+	PROFILE_ISR_START();
+	start_next_transfer();
+	PROFILE_ISR_END(PROFILE_SPI_STC);
 }
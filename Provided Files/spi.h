@@ -14,7 +14,17 @@
 void spi_setup_master(uint8_t clockdivider);
 
 // Send and receive an SPI byte. This function will take at least 8 
-// cyles of the divided clock (i.e. will busy wait).
+// cyles of the divided clock (i.e. will busy wait). Any queued bytes
+// are sent first.
 uint8_t spi_send_byte(uint8_t byte);
 
+// Add a byte to the queue of bytes to send. Queued bytes are sent in
+// order by the SPI transfer complete interrupt, so this returns
+// immediately unless the queue is full, in which case it busy waits
+// until there is room. Received bytes are discarded.
+void spi_queue_byte(uint8_t byte);
+
+// Busy wait until all queued bytes have been sent.
+void spi_wait_until_sent(void);
+
 #endif /* SPI_H_ */
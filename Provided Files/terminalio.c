@@ -7,7 +7,12 @@
 #include "terminalio.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <avr/pgmspace.h>
+#include "serialio.h"
+
+/* Longest message print_cosmetic_at_P() will send, cursor move included */
+#define COSMETIC_LINE_SIZE 80
 
 
 void move_terminal_cursor(int x, int y)
@@ -97,3 +102,17 @@ void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y)
 	printf(" ");
 	normal_display_mode();
 }
+
+int8_t print_cosmetic_at_P(int x, int y, const char *text)
+{
+	char message[COSMETIC_LINE_SIZE];
+	int length = snprintf_P(message, sizeof(message), PSTR("\x1b[%d;%dH"), y, x);
+	strncpy_P(message + length, text, sizeof(message) - length - 1);
+	message[sizeof(message) - 1] = '\0';
+	return serial_write_cosmetic(message, strlen(message));
+}
+
+int8_t clear_line_cosmetic(int x, int y)
+{
+	return print_cosmetic_at_P(x, y, PSTR("\x1b[K"));
+}
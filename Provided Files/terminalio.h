@@ -86,4 +86,12 @@ void scroll_up(void);
 void draw_horizontal_line(int8_t y, int8_t startx, int8_t endx);
 void draw_vertical_line(int8_t x, int8_t starty, int8_t endy);
 
+// Cosmetic versions of move_terminal_cursor() followed by printing text
+// (in program memory) or clearing to the end of the line. The cursor move
+// and the text are sent as one message which is dropped rather than
+// waiting for room in the serial output buffer (see serialio.h). Returns
+// 1 if it was sent, 0 if it was dropped.
+int8_t print_cosmetic_at_P(int x, int y, const char *text);
+int8_t clear_line_cosmetic(int x, int y);
+
 #endif /* TERMINAL_IO_H */
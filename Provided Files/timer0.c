@@ -9,14 +9,34 @@
  */
 
 #include "timer0.h"
-#include "game.h"
+#include "buttons.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include "profile.h"
+
+volatile uint8_t game_paused;
 
 /* Our internal clock tick count - incremented every
  * millisecond. Will overflow every ~49 days. */
 static volatile uint32_t clock_ticks_ms;
 
+/* Milliseconds since the timer was initialised, pause or not. The fine
+ * clock is built on this, so it never goes backwards. clock_ticks_ms is
+ * behind it by the time spent paused.
+ */
+static volatile uint32_t uptime_ms;
+
+/* Beat ticks. While beat_period_ms is non-zero the interrupt handler counts
+ * a beat tick every beat_period_ms milliseconds of game time. The handler
+ * only writes beat_ticks_made and beat_phase_ms, and the main loop only
+ * writes beat_ticks_taken, so the main loop can take ticks without turning
+ * interrupts off. The counts wrap around at 256.
+ */
+static volatile uint16_t beat_period_ms;
+static volatile uint16_t beat_phase_ms;
+static volatile uint8_t beat_ticks_made;
+static volatile uint8_t beat_ticks_taken;
+
 /* Set up timer 0 to generate an interrupt every 1ms.
  * We will divide the clock by 64 and count up to 124.
  * We will therefore get an interrupt every 64 x 125
@@ -31,6 +51,7 @@ void init_timer0(void)
 	 * constant.
 	 */
 	clock_ticks_ms = 0L;
+	uptime_ms = 0L;
 
 	/* Clear the timer */
 	TCNT0 = 0;
@@ -61,26 +82,122 @@ uint32_t get_current_time(void)
 {
 	uint32_t return_value;
 
-	/* Disable interrupts so we can be sure that the interrupt
-	 * doesn't fire when we've copied just a couple of bytes
-	 * of the value. Interrupts are re-enabled if they were
-	 * enabled at the start.
+	/* The interrupt could fire when we've copied just a couple of bytes
+	 * of the value, so we read it until we get the same value twice.
+	 * (Every increment changes the low byte, so a torn copy never matches
+	 * the second read.) With interrupts off the first read is always
+	 * good. This way we don't have to turn interrupts off.
+	 */
+	do
+	{
+		return_value = clock_ticks_ms;
+	} while (return_value != clock_ticks_ms);
+	return return_value;
+}
+
+/* Read the millisecond count and the timer count at the same instant,
+ * without turning interrupts off. If the compare match flag is set, the
+ * timer has wrapped around but the interrupt hasn't run yet (we're in an
+ * ISR, interrupts are off, or it is just about to run) so the millisecond
+ * count is one behind. The timer count is read again after the flag in case
+ * it wrapped around between the two reads. If the interrupt runs at any
+ * point the millisecond count changes and we start again.
+ */
+static inline void read_fine_clock(uint32_t *ms, uint8_t *count)
+{
+	uint32_t start;
+	do
+	{
+		start = uptime_ms;
+		*ms = start;
+		*count = TCNT0;
+		if (TIFR0 & (1 << OCF0A))
+		{
+			*count = TCNT0;
+			(*ms)++;
+		}
+	} while (start != uptime_ms);
+}
+
+uint32_t get_fine_time(void)
+{
+	uint32_t ms;
+	uint8_t count;
+	read_fine_clock(&ms, &count);
+	return ms * FINE_TIME_PER_MS + count;
+}
+
+uint16_t get_fine_time16(void)
+{
+	uint32_t ms;
+	uint8_t count;
+	read_fine_clock(&ms, &count);
+	/* Only the low 16 bits are wanted, so 16 bit arithmetic will do */
+	return (uint16_t)ms * FINE_TIME_PER_MS + count;
+}
+
+uint32_t game_time_to_fine_time(uint32_t game_time)
+{
+	/* The time spent paused only changes in the interrupt handler, which
+	 * also changes uptime_ms, so as in get_current_time() we start again
+	 * if uptime_ms changed while we read the two counts.
 	 */
+	uint32_t start, paused_ms;
+	do
+	{
+		start = uptime_ms;
+		paused_ms = start - clock_ticks_ms;
+	} while (start != uptime_ms);
+	return (game_time + paused_ms) * FINE_TIME_PER_MS;
+}
+
+uint32_t start_beat_ticks(uint16_t period_ms)
+{
 	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
 	cli();
-	return_value = clock_ticks_ms;
+	beat_period_ms = period_ms;
+	beat_phase_ms = 0;
+	beat_ticks_taken = beat_ticks_made;
+	uint32_t start_time = clock_ticks_ms;
 	if (interrupts_were_enabled)
 	{
 		sei();
 	}
-	return return_value;
+	return start_time;
+}
+
+void stop_beat_ticks(void)
+{
+	beat_period_ms = 0;
+	beat_ticks_taken = beat_ticks_made;
+}
+
+uint8_t take_beat_ticks(void)
+{
+	uint8_t ticks = beat_ticks_made - beat_ticks_taken;
+	beat_ticks_taken += ticks;
+	return ticks;
 }
 
 ISR(TIMER0_COMPA_vect)
 {
+	PROFILE_ISR_START();
+	uptime_ms++;
+
 	/* Increment our clock tick count */
 	if (!game_paused)
 	{
 		clock_ticks_ms++;
+		
+		/* Count a beat tick at the end of each beat period */
+		if (beat_period_ms && ++beat_phase_ms == beat_period_ms)
+		{
+			beat_phase_ms = 0;
+			beat_ticks_made++;
+		}
 	}
+	
+	/* Buttons settle in real time, paused or not */
+	button_debounce_tick();
+	PROFILE_ISR_END(PROFILE_TIMER0_COMPA);
 }
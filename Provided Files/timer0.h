@@ -20,7 +20,11 @@
 
 #include <stdint.h>
 
-uint8_t game_paused;
+/* Set while the game is paused. The clock (and everything timed by it)
+ * stops while this is non-zero. A single byte, so it can be changed at any
+ * time without turning interrupts off.
+ */
+extern volatile uint8_t game_paused;
 
 /* Set up our timer to give us an interrupt every millisecond
  * and update our time reference.
@@ -28,8 +32,47 @@ uint8_t game_paused;
 void init_timer0(void);
 
 /* Return the current clock tick value - milliseconds since the timer was
- * initialised.
+ * initialised. Doesn't turn interrupts off, so it is cheap to call in busy
+ * loops.
  */
 uint32_t get_current_time(void);
 
+/* Return the current time in timer 0 counts - units of 8 microseconds (125
+ * per millisecond) - since the timer was initialised. Unlike
+ * get_current_time() this keeps counting while the game is paused, so it
+ * never goes backwards. Safe to call from interrupt handlers, and doesn't
+ * turn interrupts off. Will overflow every ~9.5 hours.
+ */
+uint32_t get_fine_time(void);
+
+/* The low 16 bits of get_fine_time(), which is quicker to work with. Good
+ * for timing intervals of up to 524ms: the difference of two readings,
+ * as a uint16_t, is the time between them even if the count wrapped.
+ */
+uint16_t get_fine_time16(void);
+
+/* Convert a time from get_current_time() to the get_fine_time() clock,
+ * by adding the time the game has been paused so far. Only correct for
+ * times since the game was last paused.
+ */
+uint32_t game_time_to_fine_time(uint32_t game_time);
+
+/* Number of get_fine_time() units per millisecond, and microseconds per
+ * unit
+ */
+#define FINE_TIME_PER_MS 125
+#define FINE_TIME_US 8
+
+/* Beat ticks. The interrupt handler counts a beat tick every period_ms
+ * milliseconds from when start_beat_ticks() is called, on the same clock
+ * as get_current_time() (so not while the game is paused). The main loop
+ * collects them with take_beat_ticks(), which returns the number of ticks
+ * since it was last called. Any ticks not yet taken are discarded by
+ * start_beat_ticks() and stop_beat_ticks(). start_beat_ticks() returns
+ * the current time, from which the ticks are counted.
+ */
+uint32_t start_beat_ticks(uint16_t period_ms);
+void stop_beat_ticks(void);
+uint8_t take_beat_ticks(void);
+
 #endif /* TIMER0_H_ */
@@ -0,0 +1,104 @@
+/*
+ * assets.c
+ *
+ * Author: Owen Harding
+ *
+ * Tables stored in program memory. See assets.h.
+ */
+
+#include "assets.h"
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "ledmatrix.h"
+#include "track.h"
+
+static const uint8_t glyphs[NUM_GLYPHS][MATRIX_NUM_COLUMNS] PROGMEM = {
+		// 'GO' on countdown
+		{0, 0, 0, 0, 70, 161, 161, 165, 165, 165, 70, 0, 0, 0, 0, 0},
+		// '1' on countdown
+		{0, 0, 0, 0, 24, 28, 24, 24, 24, 24, 60, 0, 0, 0, 0, 0},
+		// '2' on countdown
+		{0, 0, 0, 0, 60, 102, 96, 28, 12, 6, 126, 0, 0, 0, 0, 0},
+		// '3' on countdown
+		{0, 0, 0, 0, 60, 102, 96, 28, 96, 102, 60, 0, 0, 0, 0, 0},
+		// 'AVR HERO' on launch
+		{127, 164, 127, 0, 239, 29, 233, 0, 255, 170, 85, 0, 6, 9, 6, 0}};
+
+/* Seven segment display values */
+static const uint8_t seven_seg_data[11] PROGMEM = {63, 6, 91, 79, 102, 109, 125, 7, 127, 111, 64};
+
+// The song, encoded as described in track.h
+static const uint8_t track[] PROGMEM = {
+		REST(3), 0x08, REPEAT(2), 0x80, 0x04, 0x02, 0x04, 0x40,
+		0x08, 0x80, REST(2), 0x04, 0x02, 0x04, 0x40, 0x08,
+		0x04, 0x40, 0x02, 0x20, 0x01, 0x10, REPEAT(3), REST(2),
+		0x02, 0x20, 0x04, 0x40, 0x08, 0x80, 0x04, 0x40,
+		0x02, 0x20, 0x04, 0x40, 0x08, 0x04, 0x40, 0x40,
+		0x02, 0x20, 0x04, 0x40, 0x08, 0x04, 0x40, 0x02,
+		0x20, 0x01, 0x10, REPEAT(3), REST(6), 0x08, REPEAT(2), 0x80,
+		0x04, 0x02, 0x04, 0x40, 0x02, 0x08, 0x80, REST(1),
+		0x02, 0x01, 0x04, 0x40, 0x08, 0x80, 0x04, 0x02,
+		0x20, 0x01, 0x10, 0x10, 0x12, 0x20, REST(2), 0x02,
+		0x20, 0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02,
+		0x20, 0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02,
+		0x20, 0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02,
+		0x20, 0x01, 0x10, REPEAT(2), REST(4), END_OF_TRACK
+};
+
+// Timer 1 settings for a note of freq Hz, with the output high for duty
+// percent of each period, counting at 1MHz. Worked out here by the compiler
+// so that the audio interrupt doesn't have to.
+#define NOTE_PERIOD(freq) (1000000UL / (freq))
+#define NOTE_PULSE(freq, duty) (NOTE_PERIOD(freq) * (duty) / 100)
+#define NOTE_SETTING(freq, duty) \
+		{NOTE_PERIOD(freq) - 1, NOTE_PULSE(freq, duty) ? NOTE_PULSE(freq, duty) - 1 : 0}
+#define NOTE_SETTINGS(freq) \
+		{NOTE_SETTING(freq, 0), NOTE_SETTING(freq, 2), NOTE_SETTING(freq, 10), \
+		NOTE_SETTING(freq, 50), NOTE_SETTING(freq, 90), NOTE_SETTING(freq, 98)}
+
+// The note for each lane (C5, D#5, F5 and G5), at each duty cycle
+static const AudioSetting audio_settings[NUM_NOTES][NUM_DUTY_LEVELS] PROGMEM = {
+		NOTE_SETTINGS(523),
+		NOTE_SETTINGS(622),
+		NOTE_SETTINGS(698),
+		NOTE_SETTINGS(783)};
+
+// 'Combo!' in ASCII art, shown on the terminal during a combo
+static const char combo_line_0[] PROGMEM = "  ______                           __                  __ ";
+static const char combo_line_1[] PROGMEM = " /      \\                         |  \\                |  \\";
+static const char combo_line_2[] PROGMEM = "|  $$$$$$\\  ______   ______ ____  | $$____    ______  | $$";
+static const char combo_line_3[] PROGMEM = "| $$   \\$$ /      \\ |      \\    \\ | $$    \\  /      \\ | $$";
+static const char combo_line_4[] PROGMEM = "| $$      |  $$$$$$\\| $$$$$$\\$$$$\\| $$$$$$$\\|  $$$$$$\\| $$";
+static const char combo_line_5[] PROGMEM = "| $$   __ | $$  | $$| $$ | $$ | $$| $$  | $$| $$  | $$ \\$$";
+static const char combo_line_6[] PROGMEM = "| $$__/  \\| $$__/ $$| $$ | $$ | $$| $$__/ $$| $$__/ $$ __ ";
+static const char combo_line_7[] PROGMEM = " \\$$    $$ \\$$    $$| $$ | $$ | $$| $$    $$ \\$$    $$|  \\";
+static const char combo_line_8[] PROGMEM = "  \\$$$$$$   \\$$$$$$  \\$$  \\$$  \\$$ \\$$$$$$$   \\$$$$$$  \\$$";
+
+static const char *const combo_banner[COMBO_BANNER_LINES] PROGMEM = {
+		combo_line_0, combo_line_1, combo_line_2, combo_line_3, combo_line_4,
+		combo_line_5, combo_line_6, combo_line_7, combo_line_8};
+
+uint8_t asset_glyph_column(Glyph glyph, uint8_t col)
+{
+	return pgm_read_byte(&glyphs[glyph][col]);
+}
+
+uint8_t asset_seven_seg(uint8_t digit)
+{
+	return pgm_read_byte(&seven_seg_data[digit]);
+}
+
+uint8_t asset_track_byte(uint16_t offset)
+{
+	return pgm_read_byte(&track[offset]);
+}
+
+const char *asset_combo_banner_line(uint8_t line)
+{
+	return (const char *)pgm_read_ptr(&combo_banner[line]);
+}
+
+void asset_audio_setting(uint8_t note, DutyLevel duty, AudioSetting *setting)
+{
+	memcpy_P(setting, &audio_settings[note][duty], sizeof(AudioSetting));
+}
@@ -0,0 +1,77 @@
+/*
+ * assets.h
+ *
+ * Author: Owen Harding
+ *
+ * Constant data kept in program memory. On the AVR, constants that aren't
+ * marked PROGMEM are copied into SRAM at startup, so all of the game's
+ * tables live here and are read with the functions below.
+ */
+
+#ifndef ASSETS_H_
+#define ASSETS_H_
+
+#include <stdint.h>
+
+// Images for the LED matrix. Each is 16 columns of one byte, with bit n
+// set if the pixel in row n is lit.
+typedef enum
+{
+	GLYPH_GO,
+	GLYPH_ONE,
+	GLYPH_TWO,
+	GLYPH_THREE,
+	GLYPH_TITLE,
+	NUM_GLYPHS
+} Glyph;
+
+// Seven segment pattern for a minus sign (digits 0 to 9 are their own index)
+#define SEVEN_SEG_MINUS 10
+
+// Returns one column of the given LED matrix image.
+uint8_t asset_glyph_column(Glyph glyph, uint8_t col);
+
+// Returns the segments to light to show the given digit (0 to 9, or
+// SEVEN_SEG_MINUS) on the seven segment display.
+uint8_t asset_seven_seg(uint8_t digit);
+
+// Returns the byte at the given offset into the encoded track (see track.h).
+uint8_t asset_track_byte(uint16_t offset);
+
+// Duty cycles the buzzer can be driven at (percentage of each period the
+// output is high). 0 is silent; the others are louder the closer to 50.
+typedef enum
+{
+	DUTY_0,
+	DUTY_2,
+	DUTY_10,
+	DUTY_50,
+	DUTY_90,
+	DUTY_98,
+	NUM_DUTY_LEVELS
+} DutyLevel;
+
+// Number of notes the buzzer can play - one for each lane
+#define NUM_NOTES 4
+
+// Timer 1 compare values which play a note at a duty cycle: OCR1A sets the
+// period and OCR1B the pulse width, both one less than a count of 1MHz
+// timer clocks.
+typedef struct
+{
+	uint16_t top;
+	uint16_t compare;
+} AudioSetting;
+
+// Copies the timer 1 settings for the given note (0 to NUM_NOTES - 1) at
+// the given duty cycle into setting.
+void asset_audio_setting(uint8_t note, DutyLevel duty, AudioSetting *setting);
+
+// Number of lines in the 'Combo!' banner shown on the terminal
+#define COMBO_BANNER_LINES 9
+
+// Returns one line of the 'Combo!' banner. The string is in program memory
+// and must be read with the _P functions (e.g. printf_P).
+const char *asset_combo_banner_line(uint8_t line);
+
+#endif /* ASSETS_H_ */
@@ -21,6 +21,14 @@
 
 #define NUM_BUTTONS 4
 
+/* Milliseconds to ignore further changes on a button after it is pushed or
+ * released, while its contacts stop bouncing (1 to 255, or 0 to turn
+ * debouncing off). Can be set at build time, e.g. -DBUTTON_DEBOUNCE_MS=10.
+ */
+#ifndef BUTTON_DEBOUNCE_MS
+#define BUTTON_DEBOUNCE_MS 20
+#endif
+
 /* Set up pin change interrupts on pins B0 to B3.
  * It is assumed that global interrupts are off when this function is called
  * and are enabled sometime after this function is called.
@@ -28,11 +36,17 @@
 void init_button_interrupts(void);
 
 /* Return the last button pushed (0 to 3) or -1 (NO_BUTTON_PUSHED) if 
- * there are no button pushes to return. (A small queue of button pushes
- * is kept. This function should be called frequently enough to
- * ensure the queue does not overflow. Excess button pushes are
- * discarded.)
+ * there are no button pushes to return. (Button pushes and releases are
+ * queued as input events - see input.h. This function should be called
+ * frequently enough to ensure the queue does not overflow. Excess events
+ * are discarded, as are any other events taken off the queue while
+ * looking for a push.)
  */
 int8_t button_pushed(void);
 
+/* Run the debounce timing. Called every millisecond from the timer 0
+ * interrupt handler (including while the game is paused).
+ */
+void button_debounce_tick(void);
+
 #endif /* BUTTONS_H_ */
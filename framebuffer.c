@@ -0,0 +1,193 @@
+/*
+ * framebuffer.c
+ *
+ * Author: Owen Harding
+ *
+ * Shadow frame for the LED matrix. We keep two copies of the display:
+ * the frame being drawn and the frame last sent to the matrix. Flushing
+ * compares the two and sends only the differences.
+ */
+
+#include "framebuffer.h"
+#include <stdint.h>
+#include "ledmatrix.h"
+
+// Number of SPI bytes each LED matrix command costs (see ledmatrix.c).
+#define PIXEL_CMD_BYTES 3
+#define COLUMN_CMD_BYTES (2 + MATRIX_NUM_ROWS)
+#define ROW_CMD_BYTES (2 + MATRIX_NUM_COLUMNS)
+#define ALL_CMD_BYTES (1 + MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS)
+
+// The frame being drawn, and the frame the LED matrix is currently showing.
+static MatrixData frame;
+static MatrixData flushed;
+
+// Set when the frame has been drawn to since the last flush.
+static uint8_t frame_dirty;
+
+void framebuffer_init(void)
+{
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+		{
+			frame[x][y] = COLOUR_BLACK;
+			flushed[x][y] = COLOUR_BLACK;
+		}
+	}
+	frame_dirty = 0;
+	ledmatrix_clear();
+}
+
+void framebuffer_update_pixel(uint8_t x, uint8_t y, PixelColour pixel)
+{
+	if (x >= MATRIX_NUM_COLUMNS || y >= MATRIX_NUM_ROWS)
+	{
+		// Position isn't valid - we ignore the request.
+		return;
+	}
+	if (frame[x][y] != pixel)
+	{
+		frame[x][y] = pixel;
+		frame_dirty = 1;
+	}
+}
+
+void framebuffer_update_column(uint8_t x, MatrixColumn col)
+{
+	if (x >= MATRIX_NUM_COLUMNS)
+	{
+		// x value is too large - we ignore the request
+		return;
+	}
+	for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+	{
+		framebuffer_update_pixel(x, y, col[y]);
+	}
+}
+
+void framebuffer_clear(void)
+{
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+		{
+			framebuffer_update_pixel(x, y, COLOUR_BLACK);
+		}
+	}
+}
+
+void framebuffer_shift_right(void)
+{
+	// Both copies scroll together, so any changes not yet flushed are
+	// still pending afterwards, in their new position.
+	for (uint8_t x = MATRIX_NUM_COLUMNS - 1; x > 0; x--)
+	{
+		copy_matrix_column(frame[x - 1], frame[x]);
+		copy_matrix_column(flushed[x - 1], flushed[x]);
+	}
+	set_matrix_column_to_colour(frame[0], COLOUR_BLACK);
+	set_matrix_column_to_colour(flushed[0], COLOUR_BLACK);
+	ledmatrix_shift_display_right();
+}
+
+void framebuffer_flush(void)
+{
+	if (!frame_dirty)
+	{
+		return;
+	}
+	frame_dirty = 0;
+
+	// Count the changed pixels in each column and row.
+	uint8_t column_changes[MATRIX_NUM_COLUMNS];
+	uint8_t row_changes[MATRIX_NUM_ROWS] = {0};
+	uint8_t total_changes = 0;
+	uint8_t frame_is_black = 1;
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		column_changes[x] = 0;
+		for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+		{
+			if (frame[x][y] != flushed[x][y])
+			{
+				column_changes[x]++;
+				row_changes[y]++;
+				total_changes++;
+			}
+			if (frame[x][y] != COLOUR_BLACK)
+			{
+				frame_is_black = 0;
+			}
+		}
+	}
+
+	if (total_changes == 0)
+	{
+		return;
+	}
+
+	// A blank frame is a single clear command, and once enough pixels have
+	// changed it is cheaper to resend the whole display.
+	if (frame_is_black || total_changes * PIXEL_CMD_BYTES >= ALL_CMD_BYTES)
+	{
+		if (frame_is_black)
+		{
+			ledmatrix_clear();
+		}
+		else
+		{
+			ledmatrix_update_all(frame);
+		}
+		for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+		{
+			copy_matrix_column(frame[x], flushed[x]);
+		}
+		return;
+	}
+
+	// Send whole columns where that beats sending their pixels one by one.
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		if (column_changes[x] * PIXEL_CMD_BYTES > COLUMN_CMD_BYTES)
+		{
+			ledmatrix_update_column(x, frame[x]);
+			for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+			{
+				if (frame[x][y] != flushed[x][y])
+				{
+					row_changes[y]--;
+					flushed[x][y] = frame[x][y];
+				}
+			}
+		}
+	}
+
+	// Then whole rows, with whatever changes are left in them.
+	for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+	{
+		if (row_changes[y] * PIXEL_CMD_BYTES > ROW_CMD_BYTES)
+		{
+			MatrixRow row;
+			for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+			{
+				row[x] = frame[x][y];
+				flushed[x][y] = frame[x][y];
+			}
+			ledmatrix_update_row(y, row);
+		}
+	}
+
+	// Anything still different is sent a pixel at a time.
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+		{
+			if (frame[x][y] != flushed[x][y])
+			{
+				ledmatrix_update_pixel(x, y, frame[x][y]);
+				flushed[x][y] = frame[x][y];
+			}
+		}
+	}
+}
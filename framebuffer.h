@@ -0,0 +1,38 @@
+/*
+ * framebuffer.h
+ *
+ * Author: Owen Harding
+ *
+ * RAM shadow of the LED matrix. All drawing is done into the shadow frame
+ * and framebuffer_flush() sends only the pixels which differ from the last
+ * frame sent to the matrix, using whichever LED matrix command is cheapest
+ * for each changed region.
+ */
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stdint.h>
+#include "ledmatrix.h"
+
+// Clears the shadow frame and the LED matrix so that both are known to
+// match. Must be called after ledmatrix_setup() and before any drawing.
+void framebuffer_init(void);
+
+// Functions to draw into the shadow frame. Nothing is sent to the LED
+// matrix until framebuffer_flush() is called. Invalid x or y values are
+// ignored, as with the ledmatrix functions.
+void framebuffer_update_pixel(uint8_t x, uint8_t y, PixelColour pixel);
+void framebuffer_update_column(uint8_t x, MatrixColumn col);
+void framebuffer_clear(void);
+
+// Scrolls the display one column to the right using the LED matrix shift
+// command. The shadow frame scrolls with it, the rightmost column is lost
+// and the leftmost column is left blank.
+void framebuffer_shift_right(void);
+
+// Sends any changes made since the last flush to the LED matrix. Returns
+// immediately if nothing has been drawn since the last flush.
+void framebuffer_flush(void);
+
+#endif /* FRAMEBUFFER_H_ */
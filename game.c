@@ -9,40 +9,103 @@
 #include <avr/pgmspace.h>
 
 #include "game.h"
+#include "hal.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include "display.h"
 #include "ledmatrix.h"
+#include "framebuffer.h"
 #include "terminalio.h"
 #include "timer2.h"
 #include "timer0.h"
 #include "timer1.h"
+#include "track.h"
+#include "assets.h"
+#include "serialio.h"
 
-static const uint8_t track[TRACK_LENGTH] = {0x00,
-											0x00, 0x00, 0x08, 0x08, 0x08, 0x80, 0x04, 0x02,
-											0x04, 0x40, 0x08, 0x80, 0x00, 0x00, 0x04, 0x02,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x02, 0x20, 0x01,
-											0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x80, 0x04, 0x40, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x02, 0x20, 0x01,
-											0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00,
-											0x00, 0x00, 0x08, 0x08, 0x08, 0x80, 0x04, 0x02,
-											0x04, 0x40, 0x02, 0x08, 0x80, 0x00, 0x02, 0x01,
-											0x04, 0x40, 0x08, 0x80, 0x04, 0x02, 0x20, 0x01,
-											0x10, 0x10, 0x12, 0x20, 0x00, 0x00, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02, 0x20,
-											0x04, 0x40, 0x08, 0x04, 0x40, 0x40, 0x02, 0x20,
-											0x01, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00};
+uint8_t manual_mode;
+int16_t game_score;
+uint8_t combo_count;
+uint8_t combo_LEDs;
 
 uint16_t beat;
 uint8_t note_mask;
-uint8_t long_note;
 
 uint8_t note_hit_successfully;
-uint8_t game_speed_printed;
+static uint8_t btn_pressed_during_this_beat;
+
+// The values last sent to the terminal for each field that can change, so
+// that print_game_terminal() only sends the fields which have changed.
+// None of them are valid until the labels have been drawn.
+static uint8_t terminal_fields_valid;
+static int16_t shown_game_score;
+static uint8_t shown_combo_count;
+static uint8_t shown_manual_mode;
+// The combo banner is sent with cosmetic output, a line at a time, so it
+// may take several calls to print_game_terminal() to draw or clear. The
+// first combo_banner_lines lines of the banner are in combo_banner_state.
+// combo_banner_refused is set once the next line has been refused.
+static uint8_t combo_banner_state;
+static uint8_t combo_banner_lines;
+static uint8_t combo_banner_refused;
+
+// First column of the scoring area, which runs to the end of the display,
+// and the same columns as a playfield mask.
+#define SCORING_AREA_COLUMN 11
+#define SCORING_AREA_MASK ((uint16_t)(0xFFFF << SCORING_AREA_COLUMN))
+
+// The visible playfield, as one bit per column (bit 0 is column 0) for each
+// lane. note_board has the notes as they are drawn, including the bodies
+// of long notes. head_board has just the rows of short notes, which are
+// the ones that can be hit or missed. long_rows marks the rows that also
+// start a long note, since those can't be hit.
+static uint16_t note_board[4];
+static uint16_t head_board[4];
+static uint16_t long_rows;
+
+// Number of rows in the track.
+static uint16_t track_rows;
+
+// Set when notes have been played since the scoring area was last drawn.
+static uint8_t display_stale;
+
+// Times (from get_fine_time()) of the most recent advances, newest first,
+// so that a press can be judged against where the notes were when it
+// actually happened.
+#define ADVANCE_HISTORY 4
+static uint32_t advance_times[ADVANCE_HISTORY];
+
+// Track position of the next column to scroll onto the display: the
+// track row and how many columns past that row (0 to 4) it is. entry_row
+// is that row and following_row the one after, which says whether a long
+// note continues through the columns in between.
+static TrackReader entry_reader;
+static uint16_t entry_index;
+static uint8_t entry_phase;
+static uint8_t entry_row;
+static uint8_t following_row;
+
+// Columns since the last track row reached the end of the display (0 to 4).
+static uint8_t beat_phase;
+
+// The next short note still to come onto the display, which is shown as
+// a 'ghost' note. It is found with its own reader, which skips over rests
+// a run at a time rather than row by row.
+static TrackReader ghost_reader;
+static uint16_t ghost_index;
+static uint8_t ghost_row;
+
+// Colour of the notes outside the scoring area at the last full redraw.
+static PixelColour drawn_note_colour;
+
+static void scroll_in_column(void);
+static void find_ghost_note(uint16_t index);
+static PixelColour background_colour(uint8_t col);
+static uint8_t ghost_note(void);
+static void draw_column(uint8_t col);
+static PixelColour note_colour(void);
+static void redraw_changed_columns(void);
 
 // Initialise the game by resetting the grid and beat
 void initialise_game(void)
@@ -50,20 +113,50 @@ void initialise_game(void)
 	// initialise the display we are using.
 	default_grid();
 	game_score = 0;
+	seven_seg_show_score(game_score);
 	combo_count = 0;
 	combo_LEDs = 0;
-	duty_percentage = 0;
+	audio_stop();
 
 	beat = 0;
+	beat_phase = 0;
+
+	track_rows = track_length();
+	track_reader_start(&entry_reader);
+	entry_index = 0;
+	entry_phase = 0;
+	entry_row = track_reader_next(&entry_reader);
+	following_row = track_reader_next(&entry_reader);
+	track_reader_start(&ghost_reader);
+	ghost_index = 0;
+	ghost_row = track_reader_next(&ghost_reader);
+
+	// Fill the playfield by scrolling in the first 16 track positions.
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		note_board[lane] = 0;
+		head_board[lane] = 0;
+	}
+	long_rows = 0;
+	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++)
+	{
+		scroll_in_column();
+	}
+
+	for (uint8_t i = 0; i < ADVANCE_HISTORY; i++)
+	{
+		advance_times[i] = 0;
+	}
 
 	note_mask = 0;
 	btn_pressed_during_this_beat = 0;
-	game_speed_printed = 0;
-	print_game_terminal(1);
+	display_stale = 0;
+	redraw_notes();
+	print_game_terminal();
 }
 
 // Play a note in the given lane
-void play_note(uint8_t lane)
+void play_note(uint8_t lane, uint32_t press_time)
 {
 	// Lane: unsigned integer, one of: {0, 1, 2, 3}. Indicates the btn pushed.
 
@@ -80,122 +173,76 @@ void play_note(uint8_t lane)
 		update_game_score(-1, 0);
 	}
 
-	// If applicable, turn matrix LEDs green immediately upon function call.
-	// This way there isn't delay until next beat for note to turn green.
-	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++)
+	// The notes have moved one column right for each advance since the
+	// button was actually pressed, so move them back to judge the press -
+	// but no further than the start of this beat window. The flags above
+	// (and the miss charged for the note that left the display as the
+	// window started) belong to this window, so a press from before it is
+	// judged as if it happened as the window started.
+	uint8_t window_advances = beat_phase ? beat_phase : 5;
+	uint8_t late = 0;
+	while (late < ADVANCE_HISTORY && late < window_advances - 1
+			&& (int32_t)(advance_times[late] - press_time) > 0)
 	{
-		// col counts from one end, future from the other
-		uint8_t future = MATRIX_NUM_COLUMNS - 1 - col;
-		uint8_t index = (future + beat) / 5;
-		uint8_t note = track[index];
-		uint8_t long_note = 0;
-		// Filter out short notes by bitwise anding 1111 on left nybble.
-		if (note & 0xf0)
-		{
-			note = note >> 4;
-			long_note = 1;
-		}
-		if ((future + beat) % 5 && long_note == 0)
-		{
-			continue;
-			// notes are only drawn every five columns
-		}
+		late++;
+	}
 
-		// if the index is beyond the end of the track,
-		// no note can be drawn
-		if (index >= TRACK_LENGTH)
+	// A short note in this lane within the scoring area can be hit. Short
+	// notes are five columns apart, so there is at most one.
+	uint16_t hit = (head_board[lane] & ~long_rows) >> late;
+	hit &= SCORING_AREA_MASK;
+	if (hit && !btn_pressed_during_this_beat)
+	{
+		// future counts columns left until the end of the display
+		uint8_t future = MATRIX_NUM_COLUMNS - 1;
+		DutyLevel duty = DUTY_0;
+		while (!(hit & 1))
 		{
-			continue;
+			hit >>= 1;
+			future--;
 		}
 
-		// iterate over the four paths
-
-		if (note_mask & note & (1 << lane) && (future < 5) && !btn_pressed_during_this_beat && !long_note)
+		if (future == 0 || future == 4)
 		{
-			ledmatrix_update_pixel(col, 2 * lane, COLOUR_GREEN);
-			ledmatrix_update_pixel(col, 2 * lane + 1, COLOUR_GREEN);
-
-			if (future == 0 || future == 4)
+			update_game_score(1, 0);
+			if (future == 4)
 			{
-				update_game_score(1, 0);
-				if (future == 4)
-				{
-					duty_percentage = 2;
-				}
-				else if (future == 0)
-				{
-					duty_percentage = 98;
-				}
+				duty = DUTY_2;
 			}
-			else if (future == 1 || future == 3)
+			else if (future == 0)
 			{
-				update_game_score(2, 0);
-				if (future == 3)
-				{
-					duty_percentage = 10;
-				}
-				else if (future == 1)
-				{
-					duty_percentage = 90;
-				}
+				duty = DUTY_98;
 			}
-			else if (future == 2)
+		}
+		else if (future == 1 || future == 3)
+		{
+			update_game_score(2, 0);
+			if (future == 3)
 			{
-				if (combo_count > 3)
-				{
-					update_game_score(4, 1);
-				}
-				else
-				{
-					update_game_score(3, 1);
-				}
-				duty_percentage = 50;
+				duty = DUTY_10;
 			}
-
-			switch (lane)
+			else if (future == 1)
 			{
-				case 0:
-					freq = 523.2511;
-				case 1:
-					freq = 622.2540;
-				case 2:
-					freq = 698.4565;
-				case 3:
-					freq = 783.9909;
+				duty = DUTY_90;
 			}
-
-			note_hit_successfully = 1;
-		}
-	}
-
-	for (uint16_t future = 16;; future++)
-	{
-		if ((future + beat) % 5)
-		{
-			continue;
 		}
-		uint8_t index = (future + beat) / 5;
-
-		if (index >= TRACK_LENGTH)
-		{
-			break;
-		}
-		if (track[index] & 0x0f)
+		else if (future == 2)
 		{
+			if (combo_count > 3)
 			{
-				if (track[index] & (1 << lane) && (combo_count >= 3))
-				{
-					ledmatrix_update_pixel(0, 2 * lane, COLOUR_QUART_ORANGE);
-					ledmatrix_update_pixel(0, 2 * lane + 1, COLOUR_QUART_ORANGE);
-				}
-				else if (track[index] & (1 << lane))
-				{
-					ledmatrix_update_pixel(0, 2 * lane, COLOUR_QUART_RED);
-					ledmatrix_update_pixel(0, 2 * lane + 1, COLOUR_QUART_RED);
-				}
+				update_game_score(4, 1);
 			}
-			break;
+			else
+			{
+				update_game_score(3, 1);
+			}
+			duty = DUTY_50;
 		}
+
+		// Each lane has its own note, played louder the closer the hit
+		audio_play(lane, duty);
+
+		note_hit_successfully = 1;
 	}
 
 	// Deduct 1 point if button is pressed without a valid note.
@@ -206,77 +253,27 @@ void play_note(uint8_t lane)
 
 	btn_pressed_during_this_beat = 1;
 
-	redraw_notes();
-
-	// printf("\rGame Score: %5d", game_score);
-	print_game_terminal(0);
+	// Hit notes turn green at the next update_game_display() rather than
+	// waiting for the next beat.
+	display_stale = 1;
 }
 
-// Advance the notes one row down the display
-void advance_note(void)
+// Moves the game on one track position without drawing anything: judges
+// any note leaving the display and scrolls the next position onto the
+// playfield.
+static void advance_beat(void)
 {
-	// remove all the current notes; reverse of below
-	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++)
+	if (beat_phase == 0)
 	{
-		uint8_t future = MATRIX_NUM_COLUMNS - 1 - col;
-		uint8_t index = (future + beat) / 5;
-		uint8_t long_note = 0;
-		uint8_t note = track[index];
-		if (index >= TRACK_LENGTH)
-		{
-			break;
-		}
-		if (note & 0xf0)
-		{
-			// Shift left nybble into part that gets read.
-			note = note >> 4;
-		}
-		if (track[index + 1] & 0xF0)
-		{
-			long_note = 1;
-		}
-
-		if ((future + beat) % 5 && long_note == 0)
-		{
-			continue;
-			// notes are only drawn every five columns
-		}
-
+		// If a note isn't zero, leaves the board, and didn't get hit, deduct.
+		uint16_t leaving = 0;
 		for (uint8_t lane = 0; lane < 4; lane++)
 		{
-			if (note & (1 << lane))
-			{
-				PixelColour colour;
-				// yellows in the scoring area
-				if (col == 11 || col == 15)
-				{
-					colour = COLOUR_QUART_YELLOW;
-				}
-				else if (col == 12 || col == 14)
-				{
-					colour = COLOUR_HALF_YELLOW;
-				}
-				else if (col == 13)
-				{
-					colour = COLOUR_YELLOW;
-				}
-				else
-				{
-					colour = COLOUR_BLACK;
-				}
-				ledmatrix_update_pixel(col, 2 * lane, colour);
-				ledmatrix_update_pixel(col, 2 * lane + 1, colour);
-			}
+			leaving |= head_board[lane];
 		}
-	}
-
-	if (beat % 5 == 0)
-	{
-		// If a note isn't zero, leaves the board, and didn't get hit, deduct.
-		if ((track[(beat / 5)] & 0x0F) && !note_hit_successfully)
+		if ((leaving & (1 << (MATRIX_NUM_COLUMNS - 1))) && !note_hit_successfully)
 		{
 			update_game_score(-1, 0);
-			print_game_terminal(0);
 		}
 
 		note_hit_successfully = 0;
@@ -284,149 +281,180 @@ void advance_note(void)
 		btn_pressed_during_this_beat = 0;
 	}
 
+	for (uint8_t i = ADVANCE_HISTORY - 1; i > 0; i--)
+	{
+		advance_times[i] = advance_times[i - 1];
+	}
+	advance_times[0] = get_fine_time();
+
 	// increment the beat
 	beat++;
-
-	for (uint16_t future = 16;; future++)
+	beat_phase++;
+	if (beat_phase == 5)
 	{
-		if ((future + beat) % 5)
-		{
-			continue;
-		}
-		uint8_t index = (future + beat) / 5;
-
-		if (index >= TRACK_LENGTH)
-		{
-			break;
-		}
-		if (track[index] & 0x0f)
-		{
-			for (uint8_t lane = 0; lane < 4; lane++)
-			{
-				if (track[index] & (1 << lane) && (combo_count >= 3))
-				{
-					ledmatrix_update_pixel(0, 2 * lane, COLOUR_QUART_ORANGE);
-					ledmatrix_update_pixel(0, 2 * lane + 1, COLOUR_QUART_ORANGE);
-				}
-				else if (track[index] & (1 << lane))
-				{
-					ledmatrix_update_pixel(0, 2 * lane, COLOUR_QUART_RED);
-					ledmatrix_update_pixel(0, 2 * lane + 1, COLOUR_QUART_RED);
-				}
-			}
-			break;
-		}
+		beat_phase = 0;
 	}
+	scroll_in_column();
+}
 
-	// draw the new notes
-	redraw_notes();
+// Advance the notes one row down the display
+void advance_note(void)
+{
+	advance_beat();
+
+	// Scroll the notes one column along with the LED matrix shift command,
+	// then fix up the columns a plain scroll gets wrong. Column 1 still holds
+	// the ghost note that was drawn in column 0.
+	framebuffer_shift_right();
+	draw_column(1);
+	redraw_changed_columns();
+	display_stale = 0;
 }
 
-void print_game_terminal(uint8_t update_manual_mode)
+void advance_notes(uint8_t count)
 {
+	if (count == 1)
+	{
+		advance_note();
+		return;
+	}
 
-	move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW + 1);
-	printf("Combo Count: %4d", combo_count);
-	set_display_attribute(FG_WHITE);
-	move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW);
-	printf("Game Score: %5d", game_score);
+	// Catching up. Scrolling the display for each step would only be
+	// overwritten, so move the game on and then draw the result once. We
+	// stop at the end of the track.
+	for (uint8_t i = 0; i < count && beat < track_rows * 5; i++)
+	{
+		advance_beat();
+	}
+	redraw_notes();
+	display_stale = 0;
+}
 
-	move_terminal_cursor(TERMINAL_INDENTATION, SETTINGS_BAR_ROW);
-	printf("SETTINGS");
-	if (update_manual_mode)
+void update_game_display(void)
+{
+	if (display_stale)
 	{
-		move_terminal_cursor(TERMINAL_INDENTATION, SETTINGS_BAR_ROW + 1);
-		clear_to_end_of_line();
-		if (manual_mode)
-		{
-			printf("Manual Mode:   ON");
-		}
-		else
-		{
-			printf("Manual Mode:  OFF");
-		}
+		redraw_changed_columns();
+		display_stale = 0;
 	}
-	if (!game_speed_printed)
+	print_game_terminal();
+	seven_seg_update();
+}
+
+void invalidate_game_terminal(void)
+{
+	terminal_fields_valid = 0;
+}
+
+void print_game_terminal(void)
+{
+	if (!terminal_fields_valid)
 	{
+		// The labels and game speed don't change during a game, so they are
+		// only drawn after the terminal has been cleared.
+		set_display_attribute(FG_WHITE);
+		move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW);
+		printf_P(PSTR("Game Score: "));
+		move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW + 1);
+		printf_P(PSTR("Combo Count: "));
+		move_terminal_cursor(TERMINAL_INDENTATION, SETTINGS_BAR_ROW);
+		printf_P(PSTR("SETTINGS"));
 		move_terminal_cursor(TERMINAL_INDENTATION, SETTINGS_BAR_ROW + 2);
-		printf("Game Speed: ");
+		printf_P(PSTR("Game Speed: "));
 		if (game_speed == 1000)
 		{
-			printf("Normal");
+			printf_P(PSTR("Normal"));
 		}
 		else if (game_speed == 500)
 		{
-			printf("Fast");
+			printf_P(PSTR("Fast"));
 		}
 		else if (game_speed == 250)
 		{
-			printf("Extreme");
+			printf_P(PSTR("Extreme"));
 		}
-		game_speed_printed = 1;
 	}
-	if (combo_count >= 3)
+
+	// Values are printed just after their labels.
+	if (!terminal_fields_valid || game_score != shown_game_score)
 	{
-		print_combo();
+		move_terminal_cursor(TERMINAL_INDENTATION + 12, GAME_SCORE_ROW);
+		printf("%5d", game_score);
+		shown_game_score = game_score;
 	}
-	else
+	if (!terminal_fields_valid || combo_count != shown_combo_count)
 	{
-		clear_combo();
+		move_terminal_cursor(TERMINAL_INDENTATION + 13, GAME_SCORE_ROW + 1);
+		printf("%4d", combo_count);
+		shown_combo_count = combo_count;
+	}
+	if (!terminal_fields_valid || manual_mode != shown_manual_mode)
+	{
+		move_terminal_cursor(TERMINAL_INDENTATION, SETTINGS_BAR_ROW + 1);
+		if (manual_mode)
+		{
+			printf_P(PSTR("Manual Mode:   ON"));
+		}
+		else
+		{
+			printf_P(PSTR("Manual Mode:  OFF"));
+		}
+		shown_manual_mode = manual_mode;
 	}
-}
 
-void print_combo(void)
-{
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW);
-	printf_P(PSTR("  ______                           __                  __ "));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 1);
-	printf_P(PSTR(" /      \\                         |  \\                |  \\"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 2);
-	printf_P(PSTR("|  $$$$$$\\  ______   ______ ____  | $$____    ______  | $$"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 3);
-	printf_P(PSTR("| $$   \\$$ /      \\ |      \\    \\ | $$    \\  /      \\ | $$"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 4);
-	printf_P(PSTR("| $$      |  $$$$$$\\| $$$$$$\\$$$$\\| $$$$$$$\\|  $$$$$$\\| $$"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 5);
-	printf_P(PSTR("| $$   __ | $$  | $$| $$ | $$ | $$| $$  | $$| $$  | $$ \\$$"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 5);
-	printf_P(PSTR("| $$   __ | $$  | $$| $$ | $$ | $$| $$  | $$| $$  | $$ \\$$"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 6);
-	printf_P(PSTR("| $$__/  \\| $$__/ $$| $$ | $$ | $$| $$__/ $$| $$__/ $$ __ "));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 7);
-	printf_P(PSTR(" \\$$    $$ \\$$    $$| $$ | $$ | $$| $$    $$ \\$$    $$|  \\"));
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 8);
-	printf_P(PSTR("  \\$$$$$$   \\$$$$$$  \\$$  \\$$  \\$$ \\$$$$$$$   \\$$$$$$  \\$$"));
-}
+	// The combo banner is drawn once when a combo starts and cleared once
+	// when it ends. A cleared terminal has no banner to clear. The banner is
+	// cosmetic, so when the serial link is busy we stop drawing and carry on
+	// from the same line next time rather than wait.
+	uint8_t combo_banner = (combo_count >= 3);
+	if (!terminal_fields_valid)
+	{
+		combo_banner_state = 0;
+		combo_banner_lines = COMBO_BANNER_LINES;
+		combo_banner_refused = 0;
+	}
+	if (combo_banner != combo_banner_state)
+	{
+		combo_banner_state = combo_banner;
+		combo_banner_lines = 0;
+		combo_banner_refused = 0;
+	}
+	while (combo_banner_lines < COMBO_BANNER_LINES)
+	{
+		uint8_t sent;
+		if (combo_banner_state)
+		{
+			sent = print_cosmetic_at_P(TERMINAL_INDENTATION,
+					COMBO_ROW + combo_banner_lines,
+					asset_combo_banner_line(combo_banner_lines));
+		}
+		else
+		{
+			sent = clear_line_cosmetic(TERMINAL_INDENTATION,
+					COMBO_ROW + combo_banner_lines);
+		}
+		if (!sent)
+		{
+			// Count the line once, however many passes it waits
+			if (!combo_banner_refused)
+			{
+				serial_count_refused_message();
+				combo_banner_refused = 1;
+			}
+			break;
+		}
+		combo_banner_refused = 0;
+		combo_banner_lines++;
+	}
 
-void clear_combo(void)
-{
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 1);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 2);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 3);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 4);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 5);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 5);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 6);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 7);
-	clear_to_end_of_line();
-	move_terminal_cursor(TERMINAL_INDENTATION, COMBO_ROW + 8);
-	clear_to_end_of_line();
+	terminal_fields_valid = 1;
 }
 
 // Returns 1 if the game is over, 0 otherwise.
 uint8_t is_game_over(void)
 {
 	// YOUR CODE HERE
-	if (beat / 5 == TRACK_LENGTH)
+	if (beat == track_rows * 5)
 	{
 		clear_terminal();
 		return 1;
@@ -439,8 +467,9 @@ uint8_t is_game_over(void)
 // Updates game_score and combo_count based on input.
 void update_game_score(int update_amount, uint8_t combo)
 {
-	DDRC = 14;
+	hal_gpio_set_outputs(GPIO_PORT_C, 14);
 	game_score += update_amount;
+	seven_seg_show_score(game_score);
 	if (combo)
 	{
 		combo_count++;
@@ -466,60 +495,184 @@ void update_game_score(int update_amount, uint8_t combo)
 	{
 		combo_LEDs = 0;
 	}
-	printf("Combo LEDs: %d", combo_LEDs);
+	serial_printf_cosmetic_P(PSTR("Combo LEDs: %d"), combo_LEDs);
 }
 
-void redraw_notes(void)
+// Scrolls the playfield one column along and adds the next track position
+// in column 0.
+static void scroll_in_column(void)
 {
-	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++)
+	uint8_t row = entry_row;
+	// Long notes are stored in the left nybble.
+	uint8_t lanes = row;
+	if (lanes & 0xf0)
 	{
-		// col counts from one end, future from the other
-		uint8_t future = MATRIX_NUM_COLUMNS - 1 - col;
-		uint8_t index = (future + beat) / 5;
-		uint8_t note = track[index];
-		uint8_t long_note = 0;
-		// Filter out short notes by bitwise anding 1111 on left nybble.
-		if (note & 0xf0)
+		lanes = lanes >> 4;
+	}
+	// Notes are only drawn every five columns, unless a long note follows.
+	uint8_t drawn = (entry_phase == 0 || (following_row & 0xF0));
+
+	long_rows <<= 1;
+	if (entry_phase == 0 && (row & 0xf0))
+	{
+		long_rows |= 1;
+	}
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		note_board[lane] <<= 1;
+		head_board[lane] <<= 1;
+		if (drawn && (lanes & (1 << lane)))
 		{
-			note = note >> 4;
+			note_board[lane] |= 1;
 		}
-		if (track[index + 1] & 0xF0)
+		if (entry_phase == 0 && (row & (1 << lane)))
 		{
-			long_note = 1;
+			head_board[lane] |= 1;
 		}
-		if ((future + beat) % 5 && long_note == 0)
+	}
+
+	entry_phase++;
+	if (entry_phase == 5)
+	{
+		entry_phase = 0;
+		entry_index++;
+		entry_row = following_row;
+		following_row = track_reader_next(&entry_reader);
+	}
+
+	// Short notes are on the first column of a row, so the next one to come
+	// on is in the entry row if it starts that column, otherwise later.
+	if (entry_phase == 0)
+	{
+		find_ghost_note(entry_index);
+	}
+	else
+	{
+		find_ghost_note(entry_index + 1);
+	}
+}
+
+// Moves the ghost note on to the first short note at or after the given row.
+static void find_ghost_note(uint16_t index)
+{
+	while (ghost_index < track_rows && (ghost_index < index || !(ghost_row & 0x0f)))
+	{
+		track_reader_skip_rests(&ghost_reader);
+		ghost_index = ghost_reader.index;
+		ghost_row = track_reader_next(&ghost_reader);
+	}
+}
+
+// Returns the colour of the scoring area background in the given column.
+static PixelColour background_colour(uint8_t col)
+{
+	// yellows in the scoring area
+	if (col == 11 || col == 15)
+	{
+		return COLOUR_QUART_YELLOW;
+	}
+	else if (col == 12 || col == 14)
+	{
+		return COLOUR_HALF_YELLOW;
+	}
+	else if (col == 13)
+	{
+		return COLOUR_YELLOW;
+	}
+	return COLOUR_BLACK;
+}
+
+// Returns the lanes of the ghost note shown in the first column.
+static uint8_t ghost_note(void)
+{
+	if (ghost_index >= track_rows)
+	{
+		return 0;
+	}
+	return ghost_row & 0x0f;
+}
+
+// Returns the colour notes are drawn in outside of the scoring area.
+static PixelColour note_colour(void)
+{
+	if (combo_count >= 3)
+	{
+		return COLOUR_ORANGE;
+	}
+	return COLOUR_RED;
+}
+
+// Draws one column of the playfield into the framebuffer.
+static void draw_column(uint8_t col)
+{
+	uint16_t column = (uint16_t)1 << col;
+
+	// Notes in the scoring area turn green once their lane has been pushed.
+	uint16_t green = 0;
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		if (note_mask & (1 << lane))
 		{
-			continue;
-			// notes are only drawn every five columns
+			green |= note_board[lane];
 		}
+	}
+	green &= SCORING_AREA_MASK;
 
-		// if the index is beyond the end of the track,
-		// no note can be drawn
-		if (index >= TRACK_LENGTH)
+	PixelColour colour = note_colour();
+	if (green & column)
+	{
+		colour = COLOUR_GREEN;
+	}
+	uint8_t ghost = 0;
+	PixelColour ghost_colour = COLOUR_QUART_RED;
+	if (col == 0)
+	{
+		ghost = ghost_note();
+		if (combo_count >= 3)
 		{
-			continue;
+			ghost_colour = COLOUR_QUART_ORANGE;
 		}
+	}
 
-		uint8_t color = COLOUR_RED;
-		if (combo_count >= 3)
+	// iterate over the four paths
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		PixelColour pixel = background_colour(col);
+		if (note_board[lane] & column)
 		{
-			color = COLOUR_ORANGE;
+			pixel = colour;
 		}
-		// iterate over the four paths
-		for (uint8_t lane = 0; lane < 4; lane++)
+		else if (ghost & (1 << lane))
 		{
-			if (note_mask & note && future < 5)
-			{
-
-				color = COLOUR_GREEN;
-			}
-			// check if there's a note in the specific path
-			if (note & (1 << lane))
-			{
-				// if so, colour the two pixels red
-				ledmatrix_update_pixel(col, 2 * lane, color);
-				ledmatrix_update_pixel(col, 2 * lane + 1, color);
-			}
+			pixel = ghost_colour;
 		}
+		framebuffer_update_pixel(col, 2 * lane, pixel);
+		framebuffer_update_pixel(col, 2 * lane + 1, pixel);
 	}
-}
\ No newline at end of file
+}
+
+// Redraws the columns that scrolling leaves out of date: the ghost note
+// column and the scoring area. Everything is redrawn if the note colour
+// has changed since the last full redraw.
+static void redraw_changed_columns(void)
+{
+	if (note_colour() != drawn_note_colour)
+	{
+		redraw_notes();
+		return;
+	}
+	draw_column(0);
+	for (uint8_t col = SCORING_AREA_COLUMN; col < MATRIX_NUM_COLUMNS; col++)
+	{
+		draw_column(col);
+	}
+}
+
+void redraw_notes(void)
+{
+	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++)
+	{
+		draw_column(col);
+	}
+	drawn_note_colour = note_colour();
+}
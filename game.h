@@ -14,32 +14,53 @@
 
 #include <stdint.h>
 
-#define TRACK_LENGTH 129
-
 #define TERMINAL_INDENTATION 10
 #define SETTINGS_BAR_ROW 12
 #define GAME_SCORE_ROW 8
 #define COMBO_ROW 16
 
-uint8_t manual_mode;
-uint16_t game_speed;
-int16_t game_score;
-uint8_t combo_count;
-uint16_t duty_percentage;
-uint8_t combo_LEDs;
-volatile uint8_t btn_pressed_during_this_beat;
+// Game state shared with project.c. These are only used by the main loop -
+// interrupt handlers never read them. State an interrupt handler needs is
+// handed to it through its own module (see seven_seg_show_score() and
+// audio_play()), so that it never sees a value half written.
+extern uint8_t manual_mode;
+extern uint16_t game_speed;
+extern int16_t game_score;
+extern uint8_t combo_count;
+extern uint8_t combo_LEDs;
 
 // Initialise the game by resetting the grid and beat
 void initialise_game(void);
 
-// Play a note in the given lane
-void play_note(uint8_t lane);
+// Play a note in the given lane. press_time is when the button was pressed
+// (from get_fine_time()), so that the press is judged against where the
+// notes were at that time even if they have advanced since (back as far
+// as the start of the current beat window). Only the game state is
+// changed - call update_game_display() to draw the result, once for any
+// number of notes played.
+void play_note(uint8_t lane, uint32_t press_time);
 
 // Advance the notes one row down the display
 void advance_note(void);
 
-// Prints game terminal information.
-void print_game_terminal(uint8_t update_manual_mode);
+// Advance the notes count rows (stopping at the end of the track). If more
+// than one, the rows in between are never drawn - the display is redrawn
+// once at the end. Used to catch up after falling behind.
+void advance_notes(uint8_t count);
+
+// Draws any changes made by play_note() and advance_note() since it was
+// last called into the frame buffer, prints any game terminal fields
+// that have changed, and moves a scrolling score on the seven segment
+// display along.
+void update_game_display(void);
+
+// Prints game terminal information. Only the fields which have changed
+// since they were last printed are sent.
+void print_game_terminal(void);
+
+// Makes the next print_game_terminal() print every field, for use after
+// the terminal has been cleared.
+void invalidate_game_terminal(void);
 
 // Redraws notes on the LED matrix.
 void redraw_notes(void);
@@ -47,12 +68,6 @@ void redraw_notes(void);
 // Updates game_score variable as well as handling SSD functionality.
 void update_game_score(int update_amount, uint8_t combo);
 
-// Prints ASCII 'Combo!' to the terminal.
-void print_combo(void);
-
-// Clears ASCII 'Combo!' from the terminal.
-void clear_combo(void);
-
 // Returns 1 if the game is over, 0 otherwise.
 uint8_t is_game_over(void);
 
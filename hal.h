@@ -0,0 +1,90 @@
+/*
+ * hal.h
+ *
+ * Author: Owen Harding
+ *
+ * Hardware abstraction layer. The game logic (game.c, display.c, track.c,
+ * project.c etc.) only reaches the hardware through these modules:
+ *
+ *   display	ledmatrix.h (through framebuffer.h)
+ *   clock		timer0.h
+ *   input		input.h and buttons.h
+ *   serial		serialio.h and terminalio.h
+ *   audio		timer1.h, and the seven segment display in timer2.h
+ *   GPIO		the functions below
+ *
+ * and hal_idle(), which is called by every loop that waits for time to
+ * pass or for input to arrive.
+ *
+ * There are two backends. The AVR backend is the drivers in "Provided
+ * Files" and timer1.c/timer2.c, with the functions below as inline register
+ * writes. The host backend (HOST_BUILD defined, see host/) runs the same
+ * drivers against simulated registers, with SPI replaced by a model which
+ * records the LED matrix frames, a simulated UART which records the
+ * terminal output, and the functions below recording each GPIO write.
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+	GPIO_PORT_A,
+	GPIO_PORT_B,
+	GPIO_PORT_C,
+	GPIO_PORT_D
+} GpioPort;
+
+#ifdef HOST_BUILD
+
+#include <stdio.h>
+
+// Sets the output value of all eight pins of a port.
+void hal_gpio_write(GpioPort port, uint8_t value);
+
+// Sets which pins of a port are outputs (1) and which are inputs (0).
+void hal_gpio_set_outputs(GpioPort port, uint8_t outputs);
+
+// Called while waiting. Moves the virtual clock on by a millisecond.
+void hal_idle(void);
+
+// Makes stdout and stdin streams on the serial driver's put and get
+// functions, as FDEV_SETUP_STREAM does on the AVR.
+void host_serial_open_streams(int (*put)(char, FILE *), int (*get)(FILE *));
+
+#else
+
+#include <avr/io.h>
+
+static inline void hal_gpio_write(GpioPort port, uint8_t value)
+{
+	switch (port)
+	{
+		case GPIO_PORT_A: PORTA = value; break;
+		case GPIO_PORT_B: PORTB = value; break;
+		case GPIO_PORT_C: PORTC = value; break;
+		case GPIO_PORT_D: PORTD = value; break;
+	}
+}
+
+static inline void hal_gpio_set_outputs(GpioPort port, uint8_t outputs)
+{
+	switch (port)
+	{
+		case GPIO_PORT_A: DDRA = outputs; break;
+		case GPIO_PORT_B: DDRB = outputs; break;
+		case GPIO_PORT_C: DDRC = outputs; break;
+		case GPIO_PORT_D: DDRD = outputs; break;
+	}
+}
+
+// Time is moved on by the timer interrupts, so there is nothing to do.
+static inline void hal_idle(void)
+{
+}
+
+#endif /* HOST_BUILD */
+
+#endif /* HAL_H_ */
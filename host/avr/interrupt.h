@@ -0,0 +1,22 @@
+/*
+ * host/avr/interrupt.h
+ *
+ * Author: Owen Harding
+ *
+ * Stand-in for the avr-libc header in the host build. Interrupt handlers
+ * become ordinary functions, which hal_host.c calls when the simulated
+ * hardware would raise the interrupt. sei() and cli() just set the global
+ * interrupt flag in SREG - nothing on the host can interrupt the game.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H_
+#define HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define ISR(vector) void vector(void)
+
+#define sei() (SREG |= (1 << SREG_I))
+#define cli() (SREG &= ~(1 << SREG_I))
+
+#endif /* HOST_AVR_INTERRUPT_H_ */
@@ -0,0 +1,96 @@
+/*
+ * host/avr/io.h
+ *
+ * Author: Owen Harding
+ *
+ * Stand-in for the avr-libc header in the host build. The ATmega324A
+ * registers used by the drivers are plain variables (defined in
+ * hal_host.c), so the drivers run unchanged and hal_host.c plays the part
+ * of the hardware around them.
+ */
+
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+// Every simulated register, as REG8(name) or REG16(name).
+#define HOST_REGISTERS(REG8, REG16) \
+	REG8(DDRA) REG8(DDRB) REG8(DDRC) REG8(DDRD) \
+	REG8(PORTA) REG8(PORTB) REG8(PORTC) REG8(PORTD) \
+	REG8(PINA) REG8(PINB) REG8(PINC) REG8(PIND) \
+	REG8(SREG) \
+	REG8(SPCR0) REG8(SPSR0) REG8(SPDR0) \
+	REG8(TCNT0) REG8(OCR0A) REG8(TCCR0A) REG8(TCCR0B) REG8(TIMSK0) REG8(TIFR0) \
+	REG16(TCNT1) REG16(OCR1A) REG16(OCR1B) \
+	REG8(TCCR1A) REG8(TCCR1B) REG8(TIMSK1) REG8(TIFR1) \
+	REG8(TCNT2) REG8(OCR2A) REG8(TCCR2A) REG8(TCCR2B) REG8(TIMSK2) REG8(TIFR2) \
+	REG8(PCICR) REG8(PCIFR) REG8(PCMSK1) \
+	REG16(UBRR0) REG8(UCSR0A) REG8(UCSR0B) REG8(UCSR0C) REG8(UDR0)
+
+#define HOST_DECLARE_REG8(name) extern volatile uint8_t name;
+#define HOST_DECLARE_REG16(name) extern volatile uint16_t name;
+HOST_REGISTERS(HOST_DECLARE_REG8, HOST_DECLARE_REG16)
+
+// Register bits
+#define DDB4	4
+#define DDB5	5
+#define DDB7	7
+#define DDD4	4
+#define PORTB4	4
+#define SREG_I	7
+
+#define SPI2X0	0
+#define SPR00	0
+#define SPR10	1
+#define MSTR0	4
+#define SPE0	6
+#define SPIE0	7
+#define SPIF0	7
+
+#define WGM01	1
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define OCIE0A	1
+#define OCF0A	1
+#define TOV0	0
+
+#define WGM10	0
+#define WGM11	1
+#define WGM12	3
+#define WGM13	4
+#define COM1B0	4
+#define COM1B1	5
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define OCIE1A	1
+#define OCF1A	1
+#define TOV1	0
+
+#define WGM21	1
+#define CS20	0
+#define CS21	1
+#define CS22	2
+#define OCIE2A	1
+#define OCF2A	1
+
+#define PCIE1	1
+#define PCIF1	1
+#define PCINT8	0
+#define PCINT9	1
+#define PCINT10	2
+#define PCINT11	3
+
+#define U2X0	1
+#define TXEN0	3
+#define RXEN0	4
+#define UDRIE0	5
+#define RXCIE0	7
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(reg, bit) ((reg) & _BV(bit))
+#define bit_is_clear(reg, bit) (!((reg) & _BV(bit)))
+
+#endif /* HOST_AVR_IO_H_ */
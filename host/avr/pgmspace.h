@@ -0,0 +1,34 @@
+/*
+ * host/avr/pgmspace.h
+ *
+ * Author: Owen Harding
+ *
+ * Stand-in for the avr-libc header in the host build. There is only one
+ * address space on the host, so program memory is ordinary memory and the
+ * _P functions are their standard library equivalents.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H_
+#define HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) (*(const uint16_t *)(address))
+#define pgm_read_ptr(address) (*(void * const *)(address))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strncpy_P strncpy
+#define printf_P printf
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+#endif /* HOST_AVR_PGMSPACE_H_ */
@@ -0,0 +1,393 @@
+/*
+ * bench.c
+ *
+ * Author: Owen Harding
+ *
+ * Benchmark of the game's per beat and per hit work, on the host build.
+ * The whole track is played at each speed, hitting every note in the
+ * middle of the scoring area, and each call of these is measured:
+ *
+ *   advance_note			once a beat
+ *   play_note				once a hit
+ *   update_game_display	after each hit, drawing it
+ *   print_game_terminal	once a beat
+ *   redraw_notes			once a beat, onto a blank display (the worst
+ *							case, as after catching up several beats)
+ *   update_game_score		a fixed mix of changes after each game
+ *
+ * Each call is followed by framebuffer_flush(), and what that sends to the
+ * LED matrix is counted against it. For each function the report gives
+ * host time, SPI bytes, LED matrix pixel commands and UART bytes per call,
+ * and an estimate of the time the board would take to send those bytes at
+ * the SPI clock divider and baud rate the game uses. SPI bytes are sent
+ * while the game waits, but UART bytes are sent from the transmit buffer
+ * while the game carries on, so for them the estimate is how long the
+ * serial link is kept busy. There is also a row, worst_tick, for the beat
+ * at each speed which was longest on the wire, with everything done in it
+ * as a single call. Any row whose worst case takes longer than a beat
+ * (game_speed / 5, so 50 ms at Extreme) is flagged, and reported on
+ * stderr.
+ *
+ * Usage: bench [-j]
+ *   -j	JSON output (the default is CSV)
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal_host.h"
+#include "game.h"
+#include "framebuffer.h"
+#include "ledmatrix.h"
+#include "pixel_colour.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "timer0.h"
+
+#define F_CPU 8000000UL
+
+// SPI clock divider used for the LED matrix (see ledmatrix_setup()).
+#define SPI_CLOCK_DIVIDER 128
+
+// LED matrix command to update a pixel (see ledmatrix.c).
+#define CMD_UPDATE_PIXEL 0x01
+
+// Column notes are hit in, as by the simulator's autoplay.
+#define HIT_COLUMN 13
+
+// Number of update_game_score() calls measured after each game.
+#define SCORE_UPDATES 100
+
+typedef struct
+{
+	const char *name;
+	uint32_t calls;
+	double host_ns;
+	double max_host_ns;
+	uint32_t spi_bytes;
+	uint32_t max_spi_bytes;
+	uint32_t pixel_commands;
+	uint32_t max_pixel_commands;
+	uint32_t uart_bytes;
+	uint32_t max_uart_bytes;
+	double wire_us;
+	double max_wire_us;
+} BenchStat;
+
+typedef enum
+{
+	BENCH_ADVANCE_NOTE,
+	BENCH_PLAY_NOTE,
+	BENCH_UPDATE_GAME_DISPLAY,
+	BENCH_PRINT_GAME_TERMINAL,
+	BENCH_REDRAW_NOTES,
+	BENCH_UPDATE_GAME_SCORE,
+	BENCH_TICK,
+	NUM_BENCH_STATS
+} BenchStatId;
+
+static const char *const stat_names[NUM_BENCH_STATS] = {
+	"advance_note",
+	"play_note",
+	"update_game_display",
+	"print_game_terminal",
+	"redraw_notes",
+	"update_game_score",
+	"worst_tick",
+};
+
+static BenchStat stats[NUM_BENCH_STATS];
+
+// Microseconds the board takes to send an SPI byte and a UART byte.
+static double spi_byte_us;
+static double uart_byte_us;
+
+// Counts at the start of a measurement.
+typedef struct
+{
+	struct timespec start;
+	uint32_t spi_bytes;
+	uint32_t pixel_commands;
+	uint32_t uart_bytes;
+} Sample;
+
+// What the current beat has cost so far.
+static Sample tick_start;
+
+static void take_sample(Sample *sample)
+{
+	sample->spi_bytes = host_spi_bytes();
+	sample->pixel_commands = host_matrix_commands(CMD_UPDATE_PIXEL);
+	sample->uart_bytes = host_uart_bytes();
+	clock_gettime(CLOCK_MONOTONIC, &sample->start);
+}
+
+static void add_sample(BenchStat *stat, const Sample *start,
+		double host_ns)
+{
+	uint32_t spi_bytes = host_spi_bytes() - start->spi_bytes;
+	uint32_t pixel_commands = host_matrix_commands(CMD_UPDATE_PIXEL)
+			- start->pixel_commands;
+	uint32_t uart_bytes = host_uart_bytes() - start->uart_bytes;
+	double wire_us = spi_bytes * spi_byte_us + uart_bytes * uart_byte_us;
+
+	stat->calls++;
+	stat->host_ns += host_ns;
+	stat->spi_bytes += spi_bytes;
+	stat->pixel_commands += pixel_commands;
+	stat->uart_bytes += uart_bytes;
+	stat->wire_us += wire_us;
+	if (host_ns > stat->max_host_ns)
+	{
+		stat->max_host_ns = host_ns;
+	}
+	if (spi_bytes > stat->max_spi_bytes)
+	{
+		stat->max_spi_bytes = spi_bytes;
+	}
+	if (pixel_commands > stat->max_pixel_commands)
+	{
+		stat->max_pixel_commands = pixel_commands;
+	}
+	if (uart_bytes > stat->max_uart_bytes)
+	{
+		stat->max_uart_bytes = uart_bytes;
+	}
+	if (wire_us > stat->max_wire_us)
+	{
+		stat->max_wire_us = wire_us;
+	}
+}
+
+// Host time since the sample was taken.
+static double elapsed_ns(const Sample *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->start.tv_sec) * 1e9
+			+ (end.tv_nsec - start->start.tv_nsec);
+}
+
+// Ends a measurement started with take_sample(), and adds it to the stat.
+static void end_sample(BenchStatId id, const Sample *start)
+{
+	add_sample(&stats[id], start, elapsed_ns(start));
+}
+
+// Only the worst beat (the one longest on the wire) is kept, as a single
+// sample, so its row always has one call.
+static void start_tick(void)
+{
+	take_sample(&tick_start);
+}
+
+static void end_tick(void)
+{
+	BenchStat tick;
+	memset(&tick, 0, sizeof(tick));
+	tick.name = stats[BENCH_TICK].name;
+	add_sample(&tick, &tick_start, elapsed_ns(&tick_start));
+	if (stats[BENCH_TICK].calls == 0
+			|| tick.max_wire_us > stats[BENCH_TICK].max_wire_us)
+	{
+		stats[BENCH_TICK] = tick;
+	}
+}
+
+// Returns the lanes with the front of a note in the hit column.
+static uint8_t notes_to_hit(void)
+{
+	MatrixData frame;
+	host_matrix_frame(frame);
+	uint8_t lanes = 0;
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		PixelColour pixel = frame[HIT_COLUMN][2 * lane];
+		PixelColour ahead = frame[HIT_COLUMN + 1][2 * lane];
+		if ((pixel == COLOUR_RED || pixel == COLOUR_ORANGE)
+				&& ahead != COLOUR_RED && ahead != COLOUR_ORANGE
+				&& ahead != COLOUR_GREEN)
+		{
+			lanes |= 1 << lane;
+		}
+	}
+	return lanes;
+}
+
+static void play_track(uint16_t beat_period)
+{
+	Sample sample;
+
+	// As new_game() does
+	clear_terminal();
+	invalidate_game_terminal();
+	initialise_game();
+	framebuffer_flush();
+	host_run_ms(beat_period);
+
+	while (!is_game_over())
+	{
+		start_tick();
+
+		take_sample(&sample);
+		advance_note();
+		framebuffer_flush();
+		end_sample(BENCH_ADVANCE_NOTE, &sample);
+
+		// Button 0 plays the bottom lane of the display (see play_note()).
+		uint8_t lanes = notes_to_hit();
+		for (uint8_t lane = 0; lane < 4; lane++)
+		{
+			if (lanes & (1 << lane))
+			{
+				take_sample(&sample);
+				play_note(3 - lane, get_fine_time());
+				framebuffer_flush();
+				end_sample(BENCH_PLAY_NOTE, &sample);
+
+				take_sample(&sample);
+				update_game_display();
+				framebuffer_flush();
+				end_sample(BENCH_UPDATE_GAME_DISPLAY, &sample);
+			}
+		}
+
+		take_sample(&sample);
+		print_game_terminal();
+		framebuffer_flush();
+		end_sample(BENCH_PRINT_GAME_TERMINAL, &sample);
+
+		end_tick();
+
+		// Not part of a normal beat: blank the display, then redraw it.
+		framebuffer_clear();
+		framebuffer_flush();
+		take_sample(&sample);
+		redraw_notes();
+		framebuffer_flush();
+		end_sample(BENCH_REDRAW_NOTES, &sample);
+
+		host_run_ms(beat_period);
+	}
+
+	// A mix of misses, hits and combo hits.
+	static const int8_t score_changes[] = {-1, 1, 2, 3, 4};
+	for (uint8_t i = 0; i < SCORE_UPDATES; i++)
+	{
+		int8_t change = score_changes[i % sizeof(score_changes)];
+		take_sample(&sample);
+		update_game_score(change, change >= 3);
+		framebuffer_flush();
+		end_sample(BENCH_UPDATE_GAME_SCORE, &sample);
+		host_run_ms(beat_period);
+	}
+}
+
+static void print_results(FILE *out, uint16_t speed, uint16_t beat_period,
+		uint8_t json, uint8_t *first_row)
+{
+	double budget_us = beat_period * 1000.0;
+	for (uint8_t id = 0; id < NUM_BENCH_STATS; id++)
+	{
+		BenchStat *stat = &stats[id];
+		uint32_t calls = stat->calls ? stat->calls : 1;
+		uint8_t over_budget = stat->max_wire_us > budget_us;
+		if (json)
+		{
+			fprintf(out, "%s\n  {\"speed\": %u, \"function\": \"%s\", \"calls\": %u, "
+					"\"host_ns_mean\": %.0f, \"host_ns_max\": %.0f, "
+					"\"spi_bytes_mean\": %.1f, \"spi_bytes_max\": %u, "
+					"\"pixel_commands_mean\": %.1f, \"pixel_commands_max\": %u, "
+					"\"uart_bytes_mean\": %.1f, \"uart_bytes_max\": %u, "
+					"\"wire_us_mean\": %.0f, \"wire_us_max\": %.0f, "
+					"\"budget_us\": %.0f, \"over_budget\": %s}",
+					*first_row ? "" : ",", speed, stat->name, stat->calls,
+					stat->host_ns / calls, stat->max_host_ns,
+					(double)stat->spi_bytes / calls, stat->max_spi_bytes,
+					(double)stat->pixel_commands / calls,
+					stat->max_pixel_commands,
+					(double)stat->uart_bytes / calls, stat->max_uart_bytes,
+					stat->wire_us / calls, stat->max_wire_us, budget_us,
+					over_budget ? "true" : "false");
+		}
+		else
+		{
+			fprintf(out, "%u,%s,%u,%.0f,%.0f,%.1f,%u,%.1f,%u,%.1f,%u,%.0f,%.0f,%.0f,%u\n",
+					speed, stat->name, stat->calls,
+					stat->host_ns / calls, stat->max_host_ns,
+					(double)stat->spi_bytes / calls, stat->max_spi_bytes,
+					(double)stat->pixel_commands / calls,
+					stat->max_pixel_commands,
+					(double)stat->uart_bytes / calls, stat->max_uart_bytes,
+					stat->wire_us / calls, stat->max_wire_us, budget_us,
+					over_budget);
+		}
+		if (over_budget)
+		{
+			fprintf(stderr, "%s at speed %u takes up to %.1f ms on the wire, "
+					"over the %u ms beat\n", stat->name, speed,
+					stat->max_wire_us / 1000, beat_period);
+		}
+		*first_row = 0;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t json = 0;
+	int option;
+	while ((option = getopt(argc, argv, "j")) != -1)
+	{
+		if (option == 'j')
+		{
+			json = 1;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-j]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// The game's output goes to the simulated UART; the results go here.
+	FILE *out = host_console();
+
+	initialise_hardware();
+	spi_byte_us = 8.0 * SPI_CLOCK_DIVIDER * 1e6 / F_CPU;
+	uart_byte_us = 10.0 * 1e6 / serial_actual_baudrate();
+
+	if (json)
+	{
+		fprintf(out, "[");
+	}
+	else
+	{
+		fprintf(out, "speed,function,calls,host_ns_mean,host_ns_max,"
+				"spi_bytes_mean,spi_bytes_max,pixel_commands_mean,"
+				"pixel_commands_max,uart_bytes_mean,uart_bytes_max,"
+				"wire_us_mean,wire_us_max,budget_us,over_budget\n");
+	}
+
+	static const uint16_t speeds[] = {1000, 500, 250};
+	uint8_t first_row = 1;
+	for (uint8_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+	{
+		memset(stats, 0, sizeof(stats));
+		for (uint8_t id = 0; id < NUM_BENCH_STATS; id++)
+		{
+			stats[id].name = stat_names[id];
+		}
+		game_speed = speeds[i];
+		manual_mode = 0;
+		play_track(game_speed / 5);
+		print_results(out, game_speed, game_speed / 5, json, &first_row);
+	}
+
+	if (json)
+	{
+		fprintf(out, "\n]\n");
+	}
+	return 0;
+}
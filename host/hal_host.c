@@ -0,0 +1,282 @@
+/*
+ * hal_host.c
+ *
+ * Author: Owen Harding
+ *
+ * Host backend: the simulated registers, the virtual clock which runs the
+ * timer interrupt handlers, the push buttons, the UART, and GPIO writes.
+ * SPI is in spi_host.c, and the streams serialio.c sets up are made in
+ * serialio_host.c.
+ */
+
+#include "hal_host.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hal.h"
+
+#define F_CPU 8000000L
+
+// Interrupt handlers in the drivers, called as the hardware would.
+void TIMER0_COMPA_vect(void);
+void TIMER1_COMPA_vect(void);
+void TIMER2_COMPA_vect(void);
+void PCINT1_vect(void);
+void USART0_UDRE_vect(void);
+void USART0_RX_vect(void);
+
+// Bytes waiting in serialio.c's output buffer
+extern volatile uint8_t bytes_in_out_buffer;
+
+#define HOST_DEFINE_REG8(name) volatile uint8_t name;
+#define HOST_DEFINE_REG16(name) volatile uint16_t name;
+HOST_REGISTERS(HOST_DEFINE_REG8, HOST_DEFINE_REG16)
+
+static uint32_t time_ms;
+static void (*tick_hook)(uint32_t);
+
+// The most recent GPIO writes which changed something, in a circular
+// buffer.
+#define GPIO_LOG_SIZE 256
+static GpioWrite gpio_log[GPIO_LOG_SIZE];
+static uint16_t gpio_log_next;
+static uint16_t gpio_log_count;
+static uint32_t gpio_writes;
+
+// The UART's progress (in bits times 1000) through the next byte, and a
+// received character waiting for interrupts to be turned on.
+static uint32_t send_progress;
+static int16_t received_char = -1;
+
+// Everything the UART has sent since the last host_terminal_clear(), and
+// the number of bytes sent since the program started.
+static char *terminal;
+static uint32_t terminal_length;
+static uint32_t terminal_size;
+static uint32_t uart_bytes_sent;
+
+static volatile uint8_t *const port_registers[] = {&PORTA, &PORTB, &PORTC, &PORTD};
+static volatile uint8_t *const direction_registers[] = {&DDRA, &DDRB, &DDRC, &DDRD};
+
+static uint8_t interrupts_enabled(void)
+{
+	return bit_is_set(SREG, SREG_I) != 0;
+}
+
+// Runs an interrupt handler with interrupts off, as the hardware does.
+static void run_isr(void (*vector)(void))
+{
+	cli();
+	vector();
+	sei();
+}
+
+static void record_sent(char c)
+{
+	if (terminal_length == terminal_size)
+	{
+		terminal_size = terminal_size ? terminal_size * 2 : 4096;
+		terminal = realloc(terminal, terminal_size);
+		if (!terminal)
+		{
+			abort();
+		}
+	}
+	terminal[terminal_length++] = c;
+	uart_bytes_sent++;
+}
+
+// The baud rate set in UBRR0, in normal or double speed mode.
+static long uart_baudrate(void)
+{
+	uint8_t divisor = (UCSR0A & (1 << U2X0)) ? 8 : 16;
+	return F_CPU / (divisor * (UBRR0 + 1L));
+}
+
+// Sends what the UART could send in a millisecond. Each time the data
+// register is empty and its interrupt is enabled, the handler either
+// writes the next byte to UDR0 or, with nothing left to send, turns the
+// interrupt off.
+static void uart_tick(void)
+{
+	if (received_char >= 0 && interrupts_enabled())
+	{
+		host_serial_receive(received_char);
+	}
+	if (!(UCSR0B & (1 << TXEN0)) || !(UCSR0B & (1 << UDRIE0))
+			|| !interrupts_enabled())
+	{
+		// An idle line saves nothing up for later
+		send_progress = 0;
+		return;
+	}
+	// Ten bits a byte, and baud bits a second
+	send_progress += uart_baudrate();
+	while (send_progress >= 10 * 1000 && (UCSR0B & (1 << UDRIE0)))
+	{
+		run_isr(USART0_UDRE_vect);
+		if (UCSR0B & (1 << UDRIE0))
+		{
+			record_sent(UDR0);
+			send_progress -= 10 * 1000;
+		}
+	}
+}
+
+void host_run_ms(uint32_t ms)
+{
+	while (ms-- > 0)
+	{
+		if (tick_hook)
+		{
+			tick_hook(time_ms);
+		}
+		time_ms++;
+
+		// Timer 0 has just reached its compare value and started again
+		TCNT0 = 0;
+		if (interrupts_enabled())
+		{
+			if (TIMSK0 & (1 << OCIE0A))
+			{
+				run_isr(TIMER0_COMPA_vect);
+			}
+			if (TIMSK1 & (1 << OCIE1A))
+			{
+				run_isr(TIMER1_COMPA_vect);
+			}
+			if (TIMSK2 & (1 << OCIE2A))
+			{
+				run_isr(TIMER2_COMPA_vect);
+			}
+		}
+		uart_tick();
+	}
+}
+
+uint32_t host_time_ms(void)
+{
+	return time_ms;
+}
+
+void host_set_tick_hook(void (*hook)(uint32_t now))
+{
+	tick_hook = hook;
+}
+
+void host_set_timer0_count(uint8_t count)
+{
+	TCNT0 = count;
+}
+
+void hal_idle(void)
+{
+	host_run_ms(1);
+}
+
+void host_set_button(uint8_t button, uint8_t pressed)
+{
+	uint8_t mask = 1 << button;
+	uint8_t pins = pressed ? (PINB | mask) : (PINB & ~mask);
+	if (pins == PINB)
+	{
+		return;
+	}
+	PINB = pins;
+	if (interrupts_enabled() && (PCICR & (1 << PCIE1)) && (PCMSK1 & mask))
+	{
+		run_isr(PCINT1_vect);
+	}
+}
+
+void host_serial_receive(char c)
+{
+	if (!(UCSR0B & (1 << RXEN0)))
+	{
+		// The receiver is off - the character is lost
+		return;
+	}
+	if (!interrupts_enabled())
+	{
+		// Held in the receive buffer until interrupts are turned on (a
+		// character already waiting is overwritten, as in an overrun)
+		received_char = (uint8_t)c;
+		return;
+	}
+	received_char = -1;
+	UDR0 = c;
+	if (UCSR0B & (1 << RXCIE0))
+	{
+		run_isr(USART0_RX_vect);
+	}
+	// A read which found nothing leaves the end of file flag set
+	clearerr(stdin);
+}
+
+const char *host_terminal_output(uint32_t *length)
+{
+	*length = terminal_length;
+	return terminal;
+}
+
+void host_terminal_clear(void)
+{
+	terminal_length = 0;
+}
+
+uint32_t host_uart_bytes(void)
+{
+	return uart_bytes_sent + bytes_in_out_buffer;
+}
+
+static void log_gpio_write(GpioPort port, uint8_t is_direction, uint8_t value)
+{
+	gpio_log[gpio_log_next].time = time_ms;
+	gpio_log[gpio_log_next].port = port;
+	gpio_log[gpio_log_next].is_direction = is_direction;
+	gpio_log[gpio_log_next].value = value;
+	gpio_log_next = (gpio_log_next + 1) % GPIO_LOG_SIZE;
+	if (gpio_log_count < GPIO_LOG_SIZE)
+	{
+		gpio_log_count++;
+	}
+}
+
+void hal_gpio_write(GpioPort port, uint8_t value)
+{
+	gpio_writes++;
+	if (*port_registers[port] != value)
+	{
+		*port_registers[port] = value;
+		log_gpio_write(port, 0, value);
+	}
+}
+
+void hal_gpio_set_outputs(GpioPort port, uint8_t outputs)
+{
+	gpio_writes++;
+	if (*direction_registers[port] != outputs)
+	{
+		*direction_registers[port] = outputs;
+		log_gpio_write(port, 1, outputs);
+	}
+}
+
+uint32_t host_gpio_writes(void)
+{
+	return gpio_writes;
+}
+
+uint16_t host_gpio_log(GpioWrite *writes, uint16_t max)
+{
+	uint16_t count = gpio_log_count < max ? gpio_log_count : max;
+	uint16_t index = (gpio_log_next + GPIO_LOG_SIZE - count) % GPIO_LOG_SIZE;
+	for (uint16_t i = 0; i < count; i++)
+	{
+		writes[i] = gpio_log[index];
+		index = (index + 1) % GPIO_LOG_SIZE;
+	}
+	return count;
+}
@@ -0,0 +1,105 @@
+/*
+ * hal_host.h
+ *
+ * Author: Owen Harding
+ *
+ * Host backend of the hardware abstraction layer (see hal.h). The game and
+ * its drivers run unchanged on simulated registers, single threaded, on a
+ * virtual millisecond clock. Time only moves on when host_run_ms() (or
+ * hal_idle(), from the game's waiting loops) is called, which runs the
+ * timer interrupt handlers as the hardware would. What the game sends to
+ * the LED matrix, the terminal and the GPIO pins is recorded here.
+ */
+
+#ifndef HAL_HOST_H_
+#define HAL_HOST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "hal.h"
+#include "ledmatrix.h"
+
+// Entry points in project.c, which has no header of its own.
+void initialise_hardware(void);
+void start_screen(void);
+void new_game(void);
+void play_game(void);
+void handle_game_over(void);
+
+/////////////////////////////// clock //////////////////////////////////
+
+// Moves the virtual clock on by the given number of milliseconds. For each
+// one the tick hook is called, then the timer interrupt handlers are run
+// and the UART sends what it could have sent in that time, at the baud
+// rate set in its registers.
+void host_run_ms(uint32_t ms);
+
+// Milliseconds of virtual time since the program started. (Unlike
+// get_current_time() this doesn't stop while the game is paused.)
+uint32_t host_time_ms(void);
+
+// Sets a function to be called at the start of each virtual millisecond,
+// e.g. to feed in scripted input. Pass 0 to remove it.
+void host_set_tick_hook(void (*hook)(uint32_t now));
+
+// Sets timer 0's count (0 to 124) for the rest of this millisecond, so that
+// input fed in from the tick hook is timestamped part of the way through
+// it. The count goes back to 0 when the millisecond ends.
+void host_set_timer0_count(uint8_t count);
+
+/////////////////////////////// input //////////////////////////////////
+
+// Presses (pressed non-zero) or releases one of the four push buttons,
+// running the pin change interrupt handler.
+void host_set_button(uint8_t button, uint8_t pressed);
+
+// Receives a character over the serial link, running the UART receive
+// interrupt handler. (If interrupts are off it waits until they are back
+// on.)
+void host_serial_receive(char c);
+
+/////////////////////////////// display ////////////////////////////////
+
+// Copies what the LED matrix is currently showing.
+void host_matrix_frame(MatrixData frame);
+
+// Number of SPI bytes sent to the LED matrix, and number of commands of
+// the given type (an LED matrix command byte, e.g. 0x01 to update a
+// pixel), since the program started.
+uint32_t host_spi_bytes(void);
+uint32_t host_matrix_commands(uint8_t command);
+
+/////////////////////////////// serial /////////////////////////////////
+
+// Everything the UART has sent to the terminal since the last
+// host_terminal_clear(), and the total number of bytes queued to send
+// since the program started (counted when queued, so output can be put
+// down to what queued it).
+const char *host_terminal_output(uint32_t *length);
+void host_terminal_clear(void);
+uint32_t host_uart_bytes(void);
+
+// The stdout the program started with. Once the game has set up the serial
+// port stdout is the simulated UART, so reports should go here.
+FILE *host_console(void);
+
+/////////////////////////////// GPIO ///////////////////////////////////
+
+// A GPIO write made through hal.h which changed a port or its directions.
+typedef struct
+{
+	uint32_t time;
+	uint8_t port;
+	uint8_t is_direction;
+	uint8_t value;
+} GpioWrite;
+
+// Number of GPIO writes made through hal.h since the program started
+// (changing anything or not).
+uint32_t host_gpio_writes(void);
+
+// Copies up to max of the most recent writes which changed a port or its
+// directions, oldest first, and returns how many were copied.
+uint16_t host_gpio_log(GpioWrite *writes, uint16_t max);
+
+#endif /* HAL_HOST_H_ */
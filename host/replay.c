@@ -0,0 +1,299 @@
+/*
+ * replay.c
+ *
+ * Author: Owen Harding
+ *
+ * Replays a game recorded with input_log.h. Serial keys go back in through
+ * the simulated UART, so they take the same path through the serial
+ * receive interrupt as they did on the board. Button events were logged
+ * after debouncing, so they go straight into the input queue, as the pin
+ * change interrupt handler put them there.
+ *
+ * Each record is fed in at the time (on the get_fine_time() clock, which
+ * counts on while the game is paused) it was logged at, relative to the
+ * start of play. Input events are fed in part way through their millisecond with
+ * host_set_timer0_count(), so they get the same timestamps they had when
+ * they were recorded. Commands were logged when the game loop acted on
+ * them, so they are fed in a millisecond earlier, for the game loop to act
+ * on at the same time.
+ */
+
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "hal_host.h"
+#include "game.h"
+#include "input.h"
+#include "input_log.h"
+#include "timer0.h"
+
+typedef struct
+{
+	// get_fine_time() of the record, from the start of play
+	int64_t time;
+	uint8_t type;
+	char key;
+	int16_t score;
+	uint8_t combo;
+} ReplayRecord;
+
+static ReplayRecord *records;
+static uint32_t num_records;
+static uint32_t next_record;
+static uint16_t beat_period;
+static uint8_t manual_mode_at_start;
+static uint8_t has_end;
+
+// get_fine_time() at the start of play, in milliseconds
+static uint32_t start_ms;
+
+// The log being decoded, and the position of the next byte.
+static const uint8_t *log_data;
+static size_t log_length;
+static size_t log_position;
+static const char *log_name;
+
+static void damaged(void)
+{
+	fprintf(stderr, "%s: input log is damaged at byte %zu\n", log_name,
+			log_position);
+	exit(1);
+}
+
+static uint8_t get_byte(void)
+{
+	if (log_position >= log_length)
+	{
+		damaged();
+	}
+	return log_data[log_position++];
+}
+
+static uint32_t get_varint(void)
+{
+	uint32_t value = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7)
+	{
+		uint8_t byte = get_byte();
+		value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			return value;
+		}
+	}
+	damaged();
+	return 0;
+}
+
+static int32_t get_zigzag(void)
+{
+	uint32_t value = get_varint();
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+// Picks the log out of the APC frames in a terminal capture, decoding it
+// in place. Returns its length.
+static size_t extract_frames(uint8_t *data, size_t length)
+{
+	size_t decoded = 0;
+	size_t i = 0;
+	while (i + 3 <= length)
+	{
+		if (data[i] != 0x1b || data[i + 1] != '_' || data[i + 2] != 'L')
+		{
+			i++;
+			continue;
+		}
+		i += 3;
+		while (i + 1 < length && hex_value(data[i]) >= 0
+				&& hex_value(data[i + 1]) >= 0)
+		{
+			data[decoded++] = hex_value(data[i]) << 4 | hex_value(data[i + 1]);
+			i += 2;
+		}
+	}
+	return decoded;
+}
+
+void replay_load(const char *filename)
+{
+	FILE *file = fopen(filename, "rb");
+	if (!file)
+	{
+		perror(filename);
+		exit(1);
+	}
+	uint8_t *data = 0;
+	size_t length = 0;
+	size_t size = 0;
+	size_t got;
+	do
+	{
+		if (length == size)
+		{
+			size = size ? size * 2 : 4096;
+			data = realloc(data, size);
+			if (!data)
+			{
+				abort();
+			}
+		}
+		got = fread(data + length, 1, size - length, file);
+		length += got;
+	} while (got > 0);
+	fclose(file);
+
+	if (length < 2 || data[0] != 'I' || data[1] != 'L')
+	{
+		length = extract_frames(data, length);
+	}
+	if (length < 3 || data[0] != 'I' || data[1] != 'L')
+	{
+		fprintf(stderr, "%s: no input log found\n", filename);
+		exit(1);
+	}
+	log_data = data;
+	log_length = length;
+	log_position = 2;
+	log_name = filename;
+	if (get_byte() != INPUT_LOG_VERSION)
+	{
+		fprintf(stderr, "%s: unknown input log version\n", filename);
+		exit(1);
+	}
+	beat_period = get_varint();
+	manual_mode_at_start = get_byte();
+
+	// If there is more than one game in a capture, only the first is read.
+	int64_t time = 0;
+	size = 0;
+	while (log_position < log_length && !has_end)
+	{
+		ReplayRecord record;
+		memset(&record, 0, sizeof(record));
+		time += get_zigzag();
+		record.time = time;
+		record.type = get_byte();
+		if (record.type == INPUT_LOG_COMMAND)
+		{
+			record.key = get_byte();
+		}
+		else if (record.type == INPUT_LOG_END)
+		{
+			record.score = get_zigzag();
+			record.combo = get_byte();
+			has_end = 1;
+		}
+		else if (record.type > (INPUT_LOG_SERIAL | 0x07))
+		{
+			log_position--;
+			damaged();
+		}
+		if (num_records == size)
+		{
+			size = size ? size * 2 : 256;
+			records = realloc(records, size * sizeof(ReplayRecord));
+			if (!records)
+			{
+				abort();
+			}
+		}
+		records[num_records++] = record;
+	}
+}
+
+uint16_t replay_beat_period(void)
+{
+	return beat_period;
+}
+
+uint8_t replay_manual_mode(void)
+{
+	return manual_mode_at_start;
+}
+
+void replay_start(void)
+{
+	start_ms = get_fine_time() / FINE_TIME_PER_MS;
+	next_record = 0;
+}
+
+void replay_feed(void)
+{
+	int64_t now = get_fine_time() / FINE_TIME_PER_MS;
+	while (next_record < num_records)
+	{
+		ReplayRecord *record = &records[next_record];
+		if (record->type == INPUT_LOG_END)
+		{
+			return;
+		}
+		int64_t time = (int64_t)start_ms * FINE_TIME_PER_MS + record->time;
+		int64_t due_ms = time >= 0 ? time / FINE_TIME_PER_MS : 0;
+		if (record->type == INPUT_LOG_COMMAND)
+		{
+			if (now + 1 < due_ms)
+			{
+				return;
+			}
+			host_serial_receive(record->key);
+		}
+		else
+		{
+			if (now < due_ms)
+			{
+				return;
+			}
+			if (now == due_ms && time >= 0)
+			{
+				host_set_timer0_count(time % FINE_TIME_PER_MS);
+			}
+			uint8_t lane = record->type & 0x03;
+			uint8_t pressed = (record->type & 0x04) != 0;
+			if (record->type & INPUT_LOG_SERIAL)
+			{
+				// Serial keys only give presses (see input.h)
+				host_serial_receive("fdsa"[lane]);
+			}
+			else
+			{
+				input_add_event(INPUT_BUTTON, lane, pressed);
+			}
+			host_set_timer0_count(0);
+		}
+		next_record++;
+	}
+}
+
+uint8_t replay_check(FILE *out)
+{
+	if (!has_end)
+	{
+		fprintf(out, "Replay:       log has no end, nothing to check\n");
+		return 0;
+	}
+	ReplayRecord *end = &records[num_records - 1];
+	uint8_t matches = game_score == end->score && combo_count == end->combo;
+	fprintf(out, "Replay:       %s (recorded score %d, combo %u)\n",
+			matches ? "matches" : "DIFFERS", end->score, end->combo);
+	return matches;
+}
@@ -0,0 +1,36 @@
+/*
+ * replay.h
+ *
+ * Author: Owen Harding
+ *
+ * Replays a game recorded with input_log.h in the simulator. The recorded
+ * input is fed back in at the time it originally happened, so the
+ * game plays out exactly as it did when it was recorded.
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Loads an input log. The file can be the log itself, or a capture of a
+// terminal session with the log in it (see input_log_set_output()). Exits
+// with a message if there is no log in it, or the log is damaged.
+void replay_load(const char *filename);
+
+// The beat period and manual mode setting the game was played with.
+uint16_t replay_beat_period(void);
+uint8_t replay_manual_mode(void);
+
+// Starts feeding in the log. To be called just before play_game().
+void replay_start(void);
+
+// Feeds in everything due by now. To be called from the tick hook.
+void replay_feed(void);
+
+// Compares the final score and combo with those in the log, printing the
+// result to out. Returns 1 if they match.
+uint8_t replay_check(FILE *out);
+
+#endif /* REPLAY_H_ */
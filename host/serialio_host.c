@@ -0,0 +1,74 @@
+/*
+ * serialio_host.c
+ *
+ * Author: Owen Harding
+ *
+ * Host glue for the serial driver. serialio.c runs unchanged against the
+ * simulated UART in hal_host.c, but avr-libc's FDEV_SETUP_STREAM has no
+ * host equivalent, so its put and get functions are wrapped in glibc
+ * streams here instead.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "hal_host.h"
+#include "serialio.h"
+
+static int (*put_char)(char, FILE *);
+static int (*get_char)(FILE *);
+
+static FILE *console;
+
+static ssize_t stream_write(void *cookie, const char *data, size_t size)
+{
+	(void)cookie;
+	for (size_t i = 0; i < size; i++)
+	{
+		put_char(data[i], stdout);
+	}
+	return size;
+}
+
+// Nothing on the host can type while the game waits, so a read with no
+// input waiting gives end of file rather than waiting forever.
+static ssize_t stream_read(void *cookie, char *data, size_t size)
+{
+	(void)cookie;
+	if (size == 0 || !serial_input_available())
+	{
+		return 0;
+	}
+	data[0] = get_char(stdin);
+	return 1;
+}
+
+void host_serial_open_streams(int (*put)(char, FILE *), int (*get)(FILE *))
+{
+	put_char = put;
+	get_char = get;
+	if (console)
+	{
+		return;
+	}
+	console = stdout;
+	cookie_io_functions_t functions = {
+		.read = stream_read,
+		.write = stream_write,
+	};
+	// Separate streams, so reads and writes can be mixed freely
+	stdout = fopencookie(0, "w", functions);
+	stdin = fopencookie(0, "r", functions);
+	if (!stdout || !stdin)
+	{
+		abort();
+	}
+	setvbuf(stdout, 0, _IONBF, 0);
+	setvbuf(stdin, 0, _IONBF, 0);
+}
+
+FILE *host_console(void)
+{
+	return console ? console : stdout;
+}
@@ -0,0 +1,486 @@
+/*
+ * sim.c
+ *
+ * Author: Owen Harding
+ *
+ * Simulator for the host build. Plays one game through project.c on the
+ * virtual clock, feeding in scripted button presses and serial input, and
+ * reports what each beat cost in LED matrix frames, SPI bytes and UART
+ * bytes, and the final score. Everything runs on virtual time, so a run
+ * gives the same result every time, however fast the host is.
+ *
+ * Each pass of the game's main loop takes one millisecond of virtual time
+ * (see hal_idle()), which is much slower than the board manages, so the
+ * main loop never falls behind in the simulator.
+ *
+ * Usage: sim [-s speed] [-a] [-b] [-r log] [-p log] [script]
+ *
+ *   -s speed	1 (Normal, the default), 2 (Fast) or 3 (Extreme)
+ *   -a			autoplay - press each note as it reaches the middle of the
+ *				scoring area
+ *   -b			print a CSV line for every beat
+ *   -r log		record the game's input to the file log (see input_log.h)
+ *   -p log		play back the input recorded in log (which may be a
+ *				capture of a terminal session on the board) instead of a
+ *				script or autoplay, and check that the game ends with the
+ *				recorded score and combo
+ *   script		file of input events, one per line, each one of
+ *					<ms> press <button>
+ *					<ms> release <button>
+ *					<ms> key <characters>
+ *				where <ms> is the time from the start of play (after the
+ *				countdown). Lines starting with '#' are ignored.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal_host.h"
+#include "game.h"
+#include "pixel_colour.h"
+#include "serialio.h"
+#include "input.h"
+#include "buttons.h"
+#include "input_log.h"
+#include "replay.h"
+
+// Defined in game.c - the number of columns the notes have advanced.
+extern uint16_t beat;
+
+typedef enum
+{
+	EVENT_PRESS,
+	EVENT_RELEASE,
+	EVENT_KEY
+} ScriptEventType;
+
+typedef struct
+{
+	uint32_t time;
+	ScriptEventType type;
+	uint8_t button;
+	char key;
+} ScriptEvent;
+
+static ScriptEvent *script;
+static uint32_t script_length;
+static uint32_t script_next;
+
+// Autoplay: the column notes are pressed in, how long a press is held for,
+// and when each button is to be released (0 if it isn't held).
+#define AUTOPLAY_COLUMN 13
+#define AUTOPLAY_HOLD_MS 40
+static uint8_t autoplay;
+static uint32_t release_times[NUM_BUTTONS];
+static uint8_t notes_seen;
+
+// Keys sent to the start screen: the speed, 'm' if starting in manual
+// mode, then 's' to start.
+static char start_keys[4] = {'1', 's', 0, 0};
+
+// Set when playing back an input log, and the file an input log is being
+// recorded to.
+static uint8_t replaying;
+static FILE *record_file;
+
+// Set while play_game() is running, and when it started.
+static uint8_t playing;
+static uint32_t play_start;
+static uint32_t play_start_spi_bytes;
+static uint32_t play_start_uart_bytes;
+
+// Per beat statistics, since the last beat.
+static uint8_t beat_report;
+static uint16_t last_beat;
+static uint32_t last_spi_bytes;
+static uint32_t last_uart_bytes;
+static uint32_t beat_start_spi_bytes;
+static uint32_t beat_start_uart_bytes;
+static uint32_t beat_frames;
+
+// Totals and worst cases over the game.
+static uint32_t total_frames;
+static uint32_t beats_counted;
+static uint32_t max_beat_spi_bytes;
+static uint32_t max_beat_uart_bytes;
+static uint32_t max_beat_frames;
+
+static void load_script(const char *filename)
+{
+	FILE *file = fopen(filename, "r");
+	if (!file)
+	{
+		perror(filename);
+		exit(1);
+	}
+	char line[256];
+	uint32_t line_number = 0;
+	uint32_t size = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		line_number++;
+		char *text = line + strspn(line, " \t");
+		if (*text == '#' || *text == '\n' || *text == '\r' || *text == 0)
+		{
+			continue;
+		}
+		unsigned long time;
+		char type[16];
+		int used;
+		if (sscanf(text, "%lu %15s %n", &time, type, &used) != 2)
+		{
+			fprintf(stderr, "%s:%u: can't read event\n", filename, line_number);
+			exit(1);
+		}
+		char *argument = text + used;
+		argument[strcspn(argument, "\r\n")] = 0;
+
+		ScriptEvent event;
+		event.time = time;
+		event.button = 0;
+		event.key = 0;
+		if (strcmp(type, "press") == 0 || strcmp(type, "release") == 0)
+		{
+			event.type = type[0] == 'p' ? EVENT_PRESS : EVENT_RELEASE;
+			event.button = atoi(argument);
+			if (event.button >= NUM_BUTTONS)
+			{
+				fprintf(stderr, "%s:%u: no button %s\n", filename, line_number,
+						argument);
+				exit(1);
+			}
+		}
+		else if (strcmp(type, "key") != 0)
+		{
+			fprintf(stderr, "%s:%u: unknown event %s\n", filename, line_number,
+					type);
+			exit(1);
+		}
+		else if (!*argument)
+		{
+			fprintf(stderr, "%s:%u: no keys\n", filename, line_number);
+			exit(1);
+		}
+		else
+		{
+			event.type = EVENT_KEY;
+		}
+
+		// A key event is one event for each character
+		do
+		{
+			if (event.type == EVENT_KEY)
+			{
+				event.key = *argument++;
+			}
+			if (script_length > 0 && event.time < script[script_length - 1].time)
+			{
+				fprintf(stderr, "%s:%u: events out of order\n", filename,
+						line_number);
+				exit(1);
+			}
+			if (script_length == size)
+			{
+				size = size ? size * 2 : 64;
+				script = realloc(script, size * sizeof(ScriptEvent));
+				if (!script)
+				{
+					abort();
+				}
+			}
+			script[script_length++] = event;
+		} while (event.type == EVENT_KEY && *argument);
+	}
+	fclose(file);
+}
+
+static void write_log(const uint8_t *data, uint8_t length)
+{
+	fwrite(data, 1, length, record_file);
+}
+
+// Sets the start screen keys to start the game the log was recorded from.
+static void start_replay(const char *filename)
+{
+	replay_load(filename);
+	switch (replay_beat_period())
+	{
+		case 200:
+			start_keys[0] = '1';
+			break;
+		case 100:
+			start_keys[0] = '2';
+			break;
+		case 50:
+			start_keys[0] = '3';
+			break;
+		default:
+			fprintf(stderr, "%s: unknown beat period %u ms\n", filename,
+					replay_beat_period());
+			exit(1);
+	}
+	if (replay_manual_mode())
+	{
+		start_keys[1] = 'm';
+		start_keys[2] = 's';
+	}
+	replaying = 1;
+}
+
+static uint8_t is_note(PixelColour pixel)
+{
+	return pixel == COLOUR_RED || pixel == COLOUR_ORANGE;
+}
+
+// Presses the button for each note which has just reached the autoplay
+// column, and releases buttons which have been held long enough.
+static void run_autoplay(uint32_t now)
+{
+	for (uint8_t button = 0; button < NUM_BUTTONS; button++)
+	{
+		if (release_times[button] && now >= release_times[button])
+		{
+			host_set_button(button, 0);
+			release_times[button] = 0;
+		}
+	}
+
+	// Only the front of a note is pressed. The rest of a long note follows
+	// it through the column, and turns back from green to red when the next
+	// beat starts.
+	MatrixData frame;
+	host_matrix_frame(frame);
+	uint8_t notes = 0;
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		PixelColour ahead = frame[AUTOPLAY_COLUMN + 1][2 * lane];
+		if (is_note(frame[AUTOPLAY_COLUMN][2 * lane])
+				&& !is_note(ahead) && ahead != COLOUR_GREEN)
+		{
+			notes |= 1 << lane;
+		}
+	}
+
+	// Button 0 plays the bottom lane of the display (see play_note()).
+	uint8_t arrived = notes & ~notes_seen;
+	for (uint8_t lane = 0; lane < 4; lane++)
+	{
+		uint8_t button = 3 - lane;
+		if ((arrived & (1 << lane)) && !release_times[button])
+		{
+			host_set_button(button, 1);
+			release_times[button] = now + AUTOPLAY_HOLD_MS;
+		}
+	}
+	notes_seen = notes;
+}
+
+static void end_beat(void)
+{
+	uint32_t spi_bytes = last_spi_bytes - beat_start_spi_bytes;
+	uint32_t uart_bytes = last_uart_bytes - beat_start_uart_bytes;
+	if (beat_report)
+	{
+		fprintf(host_console(), "%u,%u,%u,%u,%u,%d,%u\n", last_beat,
+				host_time_ms() - play_start, beat_frames, spi_bytes,
+				uart_bytes, game_score, combo_count);
+	}
+	beats_counted++;
+	if (spi_bytes > max_beat_spi_bytes)
+	{
+		max_beat_spi_bytes = spi_bytes;
+	}
+	if (uart_bytes > max_beat_uart_bytes)
+	{
+		max_beat_uart_bytes = uart_bytes;
+	}
+	if (beat_frames > max_beat_frames)
+	{
+		max_beat_frames = beat_frames;
+	}
+	beat_start_spi_bytes = last_spi_bytes;
+	beat_start_uart_bytes = last_uart_bytes;
+	beat_frames = 0;
+}
+
+// Called at the start of every virtual millisecond. Whatever the main loop
+// did in the last millisecond is counted, and then the input for this
+// millisecond is fed in.
+static void tick(uint32_t now)
+{
+	if (!playing)
+	{
+		// Start screen: choose the speed and start
+		for (uint8_t i = 0; i < sizeof(start_keys); i++)
+		{
+			if (start_keys[i])
+			{
+				host_serial_receive(start_keys[i]);
+				start_keys[i] = 0;
+				break;
+			}
+		}
+		return;
+	}
+
+	uint32_t spi_bytes = host_spi_bytes();
+	uint32_t uart_bytes = host_uart_bytes();
+	if (spi_bytes != last_spi_bytes)
+	{
+		// A pass which sent anything to the LED matrix drew a frame
+		beat_frames++;
+		total_frames++;
+	}
+	last_spi_bytes = spi_bytes;
+	last_uart_bytes = uart_bytes;
+	if (beat != last_beat)
+	{
+		end_beat();
+		last_beat = beat;
+	}
+
+	while (script_next < script_length
+			&& play_start + script[script_next].time <= now)
+	{
+		ScriptEvent *event = &script[script_next++];
+		if (event->type == EVENT_KEY)
+		{
+			host_serial_receive(event->key);
+		}
+		else
+		{
+			host_set_button(event->button, event->type == EVENT_PRESS);
+		}
+	}
+	if (autoplay)
+	{
+		run_autoplay(now);
+	}
+	if (replaying)
+	{
+		replay_feed();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int option;
+	const char *replay_filename = 0;
+	while ((option = getopt(argc, argv, "s:abr:p:")) != -1)
+	{
+		switch (option)
+		{
+			case 's':
+				if (optarg[0] < '1' || optarg[0] > '3' || optarg[1])
+				{
+					fprintf(stderr, "speed must be 1, 2 or 3\n");
+					return 1;
+				}
+				start_keys[0] = optarg[0];
+				break;
+			case 'a':
+				autoplay = 1;
+				break;
+			case 'b':
+				beat_report = 1;
+				break;
+			case 'r':
+				record_file = fopen(optarg, "wb");
+				if (!record_file)
+				{
+					perror(optarg);
+					return 1;
+				}
+				input_log_set_output(write_log);
+				input_log_enable(1);
+				break;
+			case 'p':
+				replay_filename = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-s speed] [-a] [-b] [-r log] "
+						"[-p log] [script]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind < argc)
+	{
+		load_script(argv[optind]);
+	}
+	if (replay_filename)
+	{
+		if (autoplay || script_length > 0)
+		{
+			fprintf(stderr, "a replay can't be mixed with other input\n");
+			return 1;
+		}
+		start_replay(replay_filename);
+	}
+
+	struct timespec wall_start, wall_end;
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+	host_set_tick_hook(tick);
+	initialise_hardware();
+	start_screen();
+	new_game();
+
+	playing = 1;
+	play_start = host_time_ms();
+	if (replaying)
+	{
+		replay_start();
+	}
+	last_beat = beat;
+	play_start_spi_bytes = host_spi_bytes();
+	play_start_uart_bytes = host_uart_bytes();
+	last_spi_bytes = beat_start_spi_bytes = play_start_spi_bytes;
+	last_uart_bytes = beat_start_uart_bytes = play_start_uart_bytes;
+	if (beat_report)
+	{
+		fprintf(host_console(), "beat,time_ms,frames,spi_bytes,uart_bytes,"
+				"score,combo\n");
+	}
+	play_game();
+	host_run_ms(1);
+	end_beat();
+	playing = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+	double wall_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1e3
+			+ (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+	uint32_t game_ms = host_time_ms() - play_start;
+	uint32_t spi_bytes = host_spi_bytes() - play_start_spi_bytes;
+	uint32_t uart_bytes = host_uart_bytes() - play_start_uart_bytes;
+
+	FILE *out = beat_report ? stderr : host_console();
+	fprintf(out, "Game time:    %u ms (%.0fx real time)\n", game_ms,
+			wall_ms > 0 ? game_ms / wall_ms : 0.0);
+	fprintf(out, "Beats:        %u\n", beats_counted);
+	fprintf(out, "Frames:       %u (at most %u in a beat)\n", total_frames,
+			max_beat_frames);
+	fprintf(out, "SPI bytes:    %u (%.1f a beat, at most %u)\n", spi_bytes,
+			beats_counted ? (double)spi_bytes / beats_counted : 0.0,
+			max_beat_spi_bytes);
+	fprintf(out, "UART bytes:   %u (%.1f a beat, at most %u)\n", uart_bytes,
+			beats_counted ? (double)uart_bytes / beats_counted : 0.0,
+			max_beat_uart_bytes);
+	fprintf(out, "Serial:       %u bytes dropped, %u deferred, "
+			"%u messages refused\n", serial_dropped_bytes(),
+			serial_deferred_bytes(), serial_refused_messages());
+	fprintf(out, "Input lost:   %u\n", input_overflow_count());
+	fprintf(out, "Score:        %d\n", game_score);
+	fprintf(out, "Combo:        %u\n", combo_count);
+	if (record_file)
+	{
+		fclose(record_file);
+	}
+	if (replaying && !replay_check(out))
+	{
+		return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * spi_host.c
+ *
+ * Author: Owen Harding
+ *
+ * Host backend for spi.h. The only thing on the SPI bus is the LED matrix,
+ * so each byte goes straight to a model of the LED matrix board, which
+ * decodes the commands sent by ledmatrix.c and keeps what the matrix would
+ * be showing.
+ */
+
+#include "spi.h"
+#include <stdint.h>
+#include "hal_host.h"
+#include "ledmatrix.h"
+
+// LED matrix commands (see ledmatrix.c)
+#define CMD_UPDATE_ALL		(0x00)
+#define CMD_UPDATE_PIXEL	(0x01)
+#define CMD_UPDATE_ROW		(0x02)
+#define CMD_UPDATE_COL		(0x03)
+#define CMD_SHIFT_DISPLAY	(0x04)
+#define CMD_CLEAR_SCREEN	(0x0F)
+#define NUM_COMMANDS		16
+
+// What the matrix is showing.
+static MatrixData display;
+
+// The command being received, its bytes so far, and how many it needs.
+static uint8_t command_bytes[1 + MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS];
+static uint8_t command_length;
+static uint8_t command_needed;
+
+static uint32_t spi_bytes;
+static uint32_t command_counts[NUM_COMMANDS];
+
+// Number of bytes following each command byte.
+static uint8_t command_data_bytes(uint8_t command)
+{
+	switch (command)
+	{
+		case CMD_UPDATE_ALL:
+			return MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS;
+		case CMD_UPDATE_PIXEL:
+			return 2;
+		case CMD_UPDATE_ROW:
+			return 1 + MATRIX_NUM_COLUMNS;
+		case CMD_UPDATE_COL:
+			return 1 + MATRIX_NUM_ROWS;
+		case CMD_SHIFT_DISPLAY:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static void shift_display(uint8_t direction)
+{
+	if (direction & 0x01)
+	{
+		// Right
+		for (uint8_t x = MATRIX_NUM_COLUMNS - 1; x > 0; x--)
+		{
+			copy_matrix_column(display[x - 1], display[x]);
+		}
+		set_matrix_column_to_colour(display[0], COLOUR_BLACK);
+	}
+	if (direction & 0x02)
+	{
+		// Left
+		for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS - 1; x++)
+		{
+			copy_matrix_column(display[x + 1], display[x]);
+		}
+		set_matrix_column_to_colour(display[MATRIX_NUM_COLUMNS - 1],
+				COLOUR_BLACK);
+	}
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		if (direction & 0x04)
+		{
+			// Down
+			for (uint8_t y = 0; y < MATRIX_NUM_ROWS - 1; y++)
+			{
+				display[x][y] = display[x][y + 1];
+			}
+			display[x][MATRIX_NUM_ROWS - 1] = COLOUR_BLACK;
+		}
+		if (direction & 0x08)
+		{
+			// Up
+			for (uint8_t y = MATRIX_NUM_ROWS - 1; y > 0; y--)
+			{
+				display[x][y] = display[x][y - 1];
+			}
+			display[x][0] = COLOUR_BLACK;
+		}
+	}
+}
+
+// Carries out a complete command.
+static void run_command(void)
+{
+	uint8_t *data = command_bytes + 1;
+	command_counts[command_bytes[0]]++;
+	switch (command_bytes[0])
+	{
+		case CMD_UPDATE_ALL:
+			for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+			{
+				for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+				{
+					display[x][y] = *data++;
+				}
+			}
+			break;
+		case CMD_UPDATE_PIXEL:
+			display[data[0] & 0x0F][(data[0] >> 4) & 0x07] = data[1];
+			break;
+		case CMD_UPDATE_ROW:
+			for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+			{
+				display[x][data[0] & 0x07] = data[1 + x];
+			}
+			break;
+		case CMD_UPDATE_COL:
+			for (uint8_t y = 0; y < MATRIX_NUM_ROWS; y++)
+			{
+				display[data[0] & 0x0F][y] = data[1 + y];
+			}
+			break;
+		case CMD_SHIFT_DISPLAY:
+			shift_display(data[0]);
+			break;
+		case CMD_CLEAR_SCREEN:
+			for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+			{
+				set_matrix_column_to_colour(display[x], COLOUR_BLACK);
+			}
+			break;
+	}
+}
+
+void spi_setup_master(uint8_t clockdivider)
+{
+	(void)clockdivider;
+	command_length = 0;
+}
+
+uint8_t spi_send_byte(uint8_t byte)
+{
+	spi_queue_byte(byte);
+	return 0;
+}
+
+void spi_queue_byte(uint8_t byte)
+{
+	spi_bytes++;
+	if (command_length == 0)
+	{
+		// Only the low four bits of a command byte are looked at
+		byte &= NUM_COMMANDS - 1;
+		command_needed = 1 + command_data_bytes(byte);
+	}
+	command_bytes[command_length++] = byte;
+	if (command_length == command_needed)
+	{
+		run_command();
+		command_length = 0;
+	}
+}
+
+void spi_wait_until_sent(void)
+{
+	// Every byte has already reached the matrix
+}
+
+void host_matrix_frame(MatrixData frame)
+{
+	for (uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++)
+	{
+		copy_matrix_column(display[x], frame[x]);
+	}
+}
+
+uint32_t host_spi_bytes(void)
+{
+	return spi_bytes;
+}
+
+uint32_t host_matrix_commands(uint8_t command)
+{
+	return command < NUM_COMMANDS ? command_counts[command] : 0;
+}
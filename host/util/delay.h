@@ -0,0 +1,16 @@
+/*
+ * host/util/delay.h
+ *
+ * Author: Owen Harding
+ *
+ * Stand-in for the avr-libc header in the host build. Busy waits take no
+ * virtual time.
+ */
+
+#ifndef HOST_UTIL_DELAY_H_
+#define HOST_UTIL_DELAY_H_
+
+#define _delay_ms(ms) ((void)(ms))
+#define _delay_us(us) ((void)(us))
+
+#endif /* HOST_UTIL_DELAY_H_ */
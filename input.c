@@ -0,0 +1,125 @@
+/*
+ * input.c
+ *
+ * Author: Owen Harding
+ *
+ * Input event queue shared by the push buttons and the serial keys. See
+ * input.h.
+ */
+
+#include "input.h"
+#include <stdint.h>
+#include "serialio.h"
+#include "timer0.h"
+
+// The event queue, a single producer, single consumer ring buffer. Events
+// are only added by interrupt handlers, which can't interrupt each other,
+// so there is one producer. The game loop is the only consumer. The
+// producer only writes queue_head and the consumer only writes queue_tail,
+// and each is a single byte, so neither side needs to turn interrupts off.
+// The indices count up freely and wrap at 256; head - tail is the number
+// of events waiting. INPUT_QUEUE_SIZE must be a power of two, no more
+// than 128.
+#define INPUT_QUEUE_SIZE 16
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+static volatile InputEvent event_queue[INPUT_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+
+// Number of events discarded because the queue was full.
+static volatile uint16_t overflow_count;
+
+void init_input(void)
+{
+	queue_head = 0;
+	queue_tail = 0;
+	overflow_count = 0;
+	input_capture_serial_keys(0);
+}
+
+void input_add_event(InputSource source, uint8_t lane, uint8_t pressed)
+{
+	uint8_t head = queue_head;
+	if ((uint8_t)(head - queue_tail) >= INPUT_QUEUE_SIZE)
+	{
+		overflow_count++;
+		return;
+	}
+	volatile InputEvent *event = &event_queue[head & INPUT_QUEUE_MASK];
+	event->timestamp = get_fine_time();
+	event->source = source;
+	event->lane = lane;
+	event->pressed = pressed;
+	// Only publish the event once it has been written
+	queue_head = head + 1;
+}
+
+uint8_t input_next_event(InputEvent *event)
+{
+	return input_drain_events(event, 1);
+}
+
+uint8_t input_drain_events(InputEvent *events, uint8_t max_events)
+{
+	// Read the head once. Events added after this are left for next time.
+	uint8_t tail = queue_tail;
+	uint8_t available = queue_head - tail;
+	if (available > max_events)
+	{
+		available = max_events;
+	}
+	for (uint8_t i = 0; i < available; i++)
+	{
+		events[i] = event_queue[(uint8_t)(tail + i) & INPUT_QUEUE_MASK];
+	}
+	// Only free the slots once the events have been copied out
+	queue_tail = tail + available;
+	return available;
+}
+
+uint16_t input_overflow_count(void)
+{
+	// The count is two bytes and may change between reading them, so read
+	// it until we get the same value twice.
+	uint16_t count;
+	do
+	{
+		count = overflow_count;
+	} while (count != overflow_count);
+	return count;
+}
+
+// Called by the serial receive interrupt handler with each character.
+// Returns 1 if the character was a lane key and has been queued.
+static int8_t serial_key_received(char c)
+{
+	uint8_t lane;
+	switch (c)
+	{
+		case 'f':
+		case 'F':
+			lane = 0;
+			break;
+		case 'd':
+		case 'D':
+			lane = 1;
+			break;
+		case 's':
+		case 'S':
+			lane = 2;
+			break;
+		case 'a':
+		case 'A':
+			lane = 3;
+			break;
+		default:
+			return 0;
+	}
+	input_add_event(INPUT_SERIAL, lane, 1);
+	return 1;
+}
+
+void input_capture_serial_keys(uint8_t enable)
+{
+	serial_set_input_hook(enable ? serial_key_received : 0);
+}
@@ -0,0 +1,62 @@
+/*
+ * input.h
+ *
+ * Author: Owen Harding
+ *
+ * A single queue of input events from the push buttons and from the serial
+ * keys used to play notes. Events are added by the interrupt handlers as
+ * the input happens, so each one carries the time it actually happened,
+ * not the time the game loop got around to it.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+	INPUT_BUTTON,
+	INPUT_SERIAL
+} InputSource;
+
+typedef struct
+{
+	// get_fine_time() when the input happened
+	uint32_t timestamp;
+	// InputSource the event came from
+	uint8_t source;
+	// Lane played, 0 to 3. For buttons this is the button number; the
+	// serial keys f, d, s and a are lanes 0 to 3 in the same order.
+	uint8_t lane;
+	// 1 for a press, 0 for a release. Serial keys only give presses.
+	uint8_t pressed;
+} InputEvent;
+
+// Empties the event queue. Serial key capture starts off disabled.
+void init_input(void);
+
+// Adds an event to the queue, timestamped now. Only to be called from an
+// interrupt handler. If the queue is full the event is discarded and
+// counted (see input_overflow_count()).
+void input_add_event(InputSource source, uint8_t lane, uint8_t pressed);
+
+// Removes the oldest event from the queue and copies it into event.
+// Returns 1 if there was an event, 0 if the queue was empty.
+uint8_t input_next_event(InputEvent *event);
+
+// Removes up to max_events of the oldest events from the queue, copying
+// them in order into events. Returns the number removed. Neither this nor
+// input_next_event() turns interrupts off.
+uint8_t input_drain_events(InputEvent *events, uint8_t max_events);
+
+// Number of events discarded because the queue was full since
+// init_input(). Wraps around at 65536.
+uint16_t input_overflow_count(void);
+
+// While enabled, the keys a, s, d and f (either case) are taken from the
+// serial input as it is received and queued as events instead of being
+// available from stdin. Other keys are unaffected.
+void input_capture_serial_keys(uint8_t enable);
+
+#endif /* INPUT_H_ */
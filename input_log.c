@@ -0,0 +1,150 @@
+/*
+ * input_log.c
+ *
+ * Author: Owen Harding
+ *
+ * Binary log of the player's input. See input_log.h for the format.
+ */
+
+#include "input_log.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "input.h"
+#include "timer0.h"
+
+// Longest record: a five byte time, the type, and a three byte score and
+// the combo for the end record.
+#define MAX_RECORD_LENGTH 10
+
+static uint8_t log_enabled;
+static void (*log_output)(const uint8_t *data, uint8_t length);
+
+// Time of the last record (or the start of play).
+static uint32_t last_time;
+
+// Writes the data to stdout as a single APC frame.
+static void write_frame(const uint8_t *data, uint8_t length)
+{
+	static const char hex_digits[] PROGMEM = "0123456789ABCDEF";
+	printf_P(PSTR("\x1b_L"));
+	for (uint8_t i = 0; i < length; i++)
+	{
+		putchar(pgm_read_byte(&hex_digits[data[i] >> 4]));
+		putchar(pgm_read_byte(&hex_digits[data[i] & 0x0F]));
+	}
+	printf_P(PSTR("\x1b\\"));
+}
+
+// Puts value into buffer as a varint, returning the number of bytes used.
+static uint8_t put_varint(uint8_t *buffer, uint32_t value)
+{
+	uint8_t length = 0;
+	while (value >= 0x80)
+	{
+		buffer[length++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buffer[length++] = value;
+	return length;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// Starts a record at the given time: puts the time since the last record
+// into buffer, returning the number of bytes used.
+static uint8_t start_record(uint8_t *buffer, uint32_t time)
+{
+	uint8_t length = put_varint(buffer, zigzag((int32_t)(time - last_time)));
+	last_time = time;
+	return length;
+}
+
+void input_log_enable(uint8_t enable)
+{
+	log_enabled = enable;
+}
+
+uint8_t input_log_enabled(void)
+{
+	return log_enabled;
+}
+
+void input_log_set_output(void (*output)(const uint8_t *data, uint8_t length))
+{
+	log_output = output;
+}
+
+// Sends a complete record (or the header).
+static void output_record(const uint8_t *data, uint8_t length)
+{
+	if (log_output)
+	{
+		log_output(data, length);
+	}
+	else
+	{
+		write_frame(data, length);
+	}
+}
+
+void input_log_start(uint32_t start_time, uint16_t beat_period,
+		uint8_t manual_mode)
+{
+	if (!log_enabled)
+	{
+		return;
+	}
+	uint8_t header[MAX_RECORD_LENGTH];
+	uint8_t length = 0;
+	header[length++] = 'I';
+	header[length++] = 'L';
+	header[length++] = INPUT_LOG_VERSION;
+	length += put_varint(header + length, beat_period);
+	header[length++] = manual_mode;
+	output_record(header, length);
+	last_time = start_time;
+}
+
+void input_log_event(const InputEvent *event)
+{
+	if (!log_enabled)
+	{
+		return;
+	}
+	uint8_t record[MAX_RECORD_LENGTH];
+	uint8_t length = start_record(record, event->timestamp);
+	record[length++] = (event->source == INPUT_SERIAL ? INPUT_LOG_SERIAL
+			: INPUT_LOG_BUTTON) | (event->pressed ? 0x04 : 0) | (event->lane & 0x03);
+	output_record(record, length);
+}
+
+void input_log_command(char key)
+{
+	if (!log_enabled)
+	{
+		return;
+	}
+	uint8_t record[MAX_RECORD_LENGTH];
+	uint8_t length = start_record(record, get_fine_time());
+	record[length++] = INPUT_LOG_COMMAND;
+	record[length++] = key;
+	output_record(record, length);
+}
+
+void input_log_end(int16_t score, uint8_t combo)
+{
+	if (!log_enabled)
+	{
+		return;
+	}
+	uint8_t record[MAX_RECORD_LENGTH];
+	uint8_t length = start_record(record, get_fine_time());
+	record[length++] = INPUT_LOG_END;
+	length += put_varint(record + length, zigzag(score));
+	record[length++] = combo;
+	output_record(record, length);
+}
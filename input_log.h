@@ -0,0 +1,72 @@
+/*
+ * input_log.h
+ *
+ * Author: Owen Harding
+ *
+ * Records everything the player does during a game as a compact binary
+ * log, so that the game can be replayed exactly (see host/replay.c).
+ *
+ * The log starts with a header:
+ *   'I' 'L' INPUT_LOG_VERSION
+ *   varint	beat period in milliseconds (game_speed / 5)
+ *   byte	manual_mode at the start of play
+ * followed by records, each one:
+ *   varint	time since the last record (or since the start of play, for
+ *			the first), in get_fine_time() units (which count on while
+ *			the game is paused), zigzag encoded since it can be negative -
+ *			see below
+ *   byte	what happened, one of
+ *			INPUT_LOG_BUTTON | pressed << 2 | lane	- a button event
+ *			INPUT_LOG_SERIAL | pressed << 2 | lane	- a serial lane key event
+ *			INPUT_LOG_COMMAND, key					- a serial command key
+ *			INPUT_LOG_END, varint score, combo		- the end of the game
+ * A varint is 7 bits a byte, least significant first, with the top bit set
+ * on every byte but the last. A zigzag encoded value n is sent as
+ * (n << 1) ^ (n >> 31), so that small negative numbers are small too.
+ *
+ * Input events are logged with the time they happened, and commands with
+ * the time the game loop acted on them, in the order the game loop saw
+ * them. An event which happened while the game loop was acting on a command
+ * can be logged after it with an earlier time.
+ */
+
+#ifndef INPUT_LOG_H_
+#define INPUT_LOG_H_
+
+#include <stdint.h>
+#include "input.h"
+
+#define INPUT_LOG_VERSION 1
+
+// Record types
+#define INPUT_LOG_BUTTON	0x00
+#define INPUT_LOG_SERIAL	0x08
+#define INPUT_LOG_COMMAND	0x10
+#define INPUT_LOG_END		0x11
+
+// Turns recording on or off. Recording starts off. While off, the
+// functions below do nothing.
+void input_log_enable(uint8_t enable);
+uint8_t input_log_enabled(void);
+
+// Sets where the log is written. By default it goes to stdout in frames of
+// "ESC _ L <hex> ESC \", an APC string which ANSI terminals ignore, so
+// the log can be picked out of a capture of the terminal session. Pass 0
+// to go back to the default.
+void input_log_set_output(void (*output)(const uint8_t *data, uint8_t length));
+
+// Starts a log for a game starting at start_time (in get_fine_time()
+// units), with the given beat period and manual mode setting.
+void input_log_start(uint32_t start_time, uint16_t beat_period,
+		uint8_t manual_mode);
+
+// Logs an input event taken from the input queue.
+void input_log_event(const InputEvent *event);
+
+// Logs a serial command key (e.g. 'p') which the game has acted on.
+void input_log_command(char key);
+
+// Ends the log with the final score and combo.
+void input_log_end(int16_t score, uint8_t combo);
+
+#endif /* INPUT_LOG_H_ */
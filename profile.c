@@ -0,0 +1,89 @@
+/*
+ * profile.c
+ *
+ * Author: Owen Harding
+ *
+ * Table of section timings. See profile.h.
+ */
+
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "terminalio.h"
+
+// Terminal row of the table's heading, below the combo banner.
+#define PROFILE_ROW 26
+
+// The interrupt handlers' entries are copied with interrupts off when
+// they are printed.
+volatile ProfileEntry profile_entries[NUM_PROFILE_SECTIONS];
+
+static const char name_timer0_compa[] PROGMEM = "TIMER0_COMPA";
+static const char name_timer1_compa[] PROGMEM = "TIMER1_COMPA";
+static const char name_timer2_compa[] PROGMEM = "TIMER2_COMPA";
+static const char name_pcint1[] PROGMEM = "PCINT1";
+static const char name_usart0_rx[] PROGMEM = "USART0_RX";
+static const char name_usart0_udre[] PROGMEM = "USART0_UDRE";
+static const char name_spi_stc[] PROGMEM = "SPI_STC";
+static const char name_play_note[] PROGMEM = "play_note";
+static const char name_advance_notes[] PROGMEM = "advance_notes";
+static const char name_update_game_display[] PROGMEM = "update_game_display";
+static const char name_framebuffer_flush[] PROGMEM = "framebuffer_flush";
+
+static PGM_P const section_names[NUM_PROFILE_SECTIONS] PROGMEM = {
+	name_timer0_compa,
+	name_timer1_compa,
+	name_timer2_compa,
+	name_pcint1,
+	name_usart0_rx,
+	name_usart0_udre,
+	name_spi_stc,
+	name_play_note,
+	name_advance_notes,
+	name_update_game_display,
+	name_framebuffer_flush,
+};
+
+void profile_dump(void)
+{
+	move_terminal_cursor(10, PROFILE_ROW);
+	printf_P(PSTR("Section              count      min      max     mean"
+			"  (clock cycles)"));
+	for (uint8_t section = 0; section < NUM_PROFILE_SECTIONS; section++)
+	{
+		ProfileEntry entry;
+		uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+		entry = *(ProfileEntry *)&profile_entries[section];
+		if (interrupts_were_enabled)
+		{
+			sei();
+		}
+
+		move_terminal_cursor(10, PROFILE_ROW + 1 + section);
+		printf_P((PGM_P)pgm_read_ptr(&section_names[section]));
+		move_terminal_cursor(30, PROFILE_ROW + 1 + section);
+		printf_P(PSTR("%6lu"), (unsigned long)entry.count);
+		if (entry.count > 0)
+		{
+			// Each time is only good to one count either way
+			uint8_t cycles = section < PROFILE_PLAY_NOTE ? PROFILE_ISR_CYCLES
+					: PROFILE_LOOP_CYCLES;
+			uint32_t mean_tenths = (entry.total * 10 + entry.count / 2)
+					/ entry.count;
+			printf_P(PSTR(" %8lu %8lu %8lu  +/-%u"),
+					(unsigned long)entry.min * cycles,
+					(unsigned long)entry.max * cycles,
+					(unsigned long)((mean_tenths * cycles + 5) / 10), cycles);
+		}
+		clear_to_end_of_line();
+	}
+}
+
+#endif /* PROFILE */
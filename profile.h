@@ -0,0 +1,135 @@
+/*
+ * profile.h
+ *
+ * Author: Owen Harding
+ *
+ * Optional timing of the interrupt handlers and the main loop's heavier
+ * functions, on the board. Only built in when PROFILE is defined (add
+ * -DPROFILE to the compiler flags); otherwise the macros below are empty
+ * and profile_dump() does nothing.
+ *
+ * Each section is timed from the START macro to the END macro, and the
+ * count, minimum, maximum and total time of each section are kept in a
+ * table in SRAM. Send 't' while playing, or at the game over screen, to
+ * print the table to the terminal, in clock cycles.
+ *
+ * The interrupt handlers are timed with TCNT1, which counts every 8 clock
+ * cycles and is always running (it plays the buzzer, silently when there
+ * is no note). Its period follows the note being played, but is never
+ * shorter than about 1.3ms - far longer than any handler should take - and
+ * timer1_top says where it wraps. Handlers started by a timer always start
+ * at the same point in timer 1's count, so their times can be up to 8
+ * cycles out, and averaging many of them doesn't help.
+ *
+ * Main loop sections are timed with get_fine_time16(), in timer 0 counts of
+ * 64 cycles, so can be up to 524ms, and include the time spent in any
+ * interrupt handlers which ran during them.
+ *
+ * Neither includes the few cycles it takes to get into and out of an
+ * interrupt handler, and the profiling itself adds a few cycles to each
+ * section. The recording is inline, so that a profiled handler doesn't
+ * have to save every register for a function call and stays close to its
+ * real cost.
+ *
+ * In the host build the timers don't count within a millisecond (see
+ * host/hal_host.h), so the profile compiles and runs, but the interrupt
+ * handlers all take 0 and the main loop sections whole milliseconds.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+// The interrupt handlers come first, then the main loop sections from
+// PROFILE_PLAY_NOTE on.
+typedef enum
+{
+	PROFILE_TIMER0_COMPA,
+	PROFILE_TIMER1_COMPA,
+	PROFILE_TIMER2_COMPA,
+	PROFILE_PCINT1,
+	PROFILE_USART0_RX,
+	PROFILE_USART0_UDRE,
+	PROFILE_SPI_STC,
+	PROFILE_PLAY_NOTE,
+	PROFILE_ADVANCE_NOTES,
+	PROFILE_UPDATE_GAME_DISPLAY,
+	PROFILE_FRAMEBUFFER_FLUSH,
+	NUM_PROFILE_SECTIONS
+} ProfileSection;
+
+#ifdef PROFILE
+
+#include <avr/io.h>
+#include "timer0.h"
+#include "timer1.h"
+
+// Clock cycles in each count of an interrupt handler's time (a timer 1
+// count) and of a main loop section's time (a timer 0 count).
+#define PROFILE_ISR_CYCLES 8
+#define PROFILE_LOOP_CYCLES 64
+
+typedef struct
+{
+	uint32_t count;
+	uint32_t total;
+	uint16_t min;
+	uint16_t max;
+} ProfileEntry;
+
+// The table (in profile.c). Each entry is only written by its own section.
+extern volatile ProfileEntry profile_entries[NUM_PROFILE_SECTIONS];
+
+// Adds one timing of a section to the table.
+static inline void profile_record(ProfileSection section, uint16_t counts)
+{
+	volatile ProfileEntry *entry = &profile_entries[section];
+	if (entry->count == 0 || counts < entry->min)
+	{
+		entry->min = counts;
+	}
+	if (counts > entry->max)
+	{
+		entry->max = counts;
+	}
+	entry->count++;
+	entry->total += counts;
+}
+
+// Timer 1 counts since start, as read from TCNT1 (it counts from 0 to
+// timer1_top, then starts again).
+static inline uint16_t profile_isr_counts(uint16_t start)
+{
+	uint16_t now = TCNT1;
+	return now >= start ? now - start : now + (timer1_top + 1) - start;
+}
+
+// For interrupt handlers, which run with interrupts off.
+#define PROFILE_ISR_START() uint16_t profile_start = TCNT1
+#define PROFILE_ISR_END(section) \
+		profile_record((section), profile_isr_counts(profile_start))
+
+// For sections of the main loop, which can take more than a millisecond.
+#define PROFILE_START(section) \
+		uint16_t profile_start_##section = get_fine_time16()
+#define PROFILE_END(section) profile_record((section), \
+		get_fine_time16() - profile_start_##section)
+
+// Prints the table to the terminal, below the game.
+void profile_dump(void);
+
+#else
+
+#define PROFILE_ISR_START()
+#define PROFILE_ISR_END(section)
+#define PROFILE_START(section)
+#define PROFILE_END(section)
+
+static inline void profile_dump(void)
+{
+}
+
+#endif /* PROFILE */
+
+#endif /* PROFILE_H_ */
@@ -8,6 +8,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
@@ -16,10 +17,25 @@
 #define F_CPU 8000000UL
 #include <util/delay.h>
 
+// Serial port baud rate. Can be overridden at build time, e.g.
+// -DSERIAL_BAUDRATE=500000, to give the terminal more bandwidth. The
+// terminal program must be set to the same rate.
+#ifndef SERIAL_BAUDRATE
+#define SERIAL_BAUDRATE 19200
+#endif
+
+// Number of input events taken off the queue at a time
+#define INPUT_BATCH_SIZE 8
+
+#include "hal.h"
 #include "game.h"
 #include "display.h"
 #include "ledmatrix.h"
+#include "framebuffer.h"
 #include "buttons.h"
+#include "input.h"
+#include "input_log.h"
+#include "profile.h"
 #include "serialio.h"
 #include "terminalio.h"
 #include "timer0.h"
@@ -36,7 +52,16 @@ void handle_game_over(void);
 
 uint16_t game_speed;
 
+// Beat scheduling statistics for the last game. A late tick is one that
+// ran after its deadline; a skipped tick is one that was advanced while
+// catching up, without being drawn.
+static uint16_t late_ticks;
+static uint16_t skipped_ticks;
+
 /////////////////////////////// main //////////////////////////////////
+// The host build (see host/) has its own main(), which calls the functions
+// below as it needs them.
+#ifndef HOST_BUILD
 int main(void)
 {
 	// Setup hardware and call backs. This will turn on
@@ -56,14 +81,16 @@ int main(void)
 		start_screen();
 	}
 }
+#endif /* HOST_BUILD */
 
 void initialise_hardware(void)
 {
 	ledmatrix_setup();
+	framebuffer_init();
 	init_button_interrupts();
-	// Setup serial port for 19200 baud communication with no echo
+	// Setup serial port for SERIAL_BAUDRATE baud communication with no echo
 	// of incoming characters
-	init_serial_stdio(19200, 0);
+	init_serial_stdio(SERIAL_BAUDRATE, 0);
 
 	init_timer0();
 	init_timer1();
@@ -103,6 +130,14 @@ void start_screen(void)
 	// change this to your name and student number; remove the chevrons <>
 	printf_P(PSTR("CSSE2010/7201 A2 by <OWEN HARDING> - <48007618>"));
 
+	// Report the serial link's actual baud rate and how far it is from the
+	// rate asked for.
+	int16_t baud_error = serial_baudrate_error();
+	move_terminal_cursor(10, 20);
+	printf_P(PSTR("Serial: %ld baud (%c%d.%d%% error)"),
+			serial_actual_baudrate(), baud_error < 0 ? '-' : '+',
+			abs(baud_error) / 10, abs(baud_error) % 10);
+
 	// Output the static start screen and wait for a push button
 	// to be pushed or a serial input of 's'
 	show_start_screen();
@@ -115,6 +150,7 @@ void start_screen(void)
 	manual_mode = 0;
 	game_paused = 0;
 	uint8_t manual_mode_printed = 0;
+	uint8_t recording_printed = 0;
 
 	// Print game speed.
 	move_terminal_cursor(10, 16);
@@ -177,6 +213,12 @@ void start_screen(void)
 			manual_mode = !manual_mode;
 		}
 
+		// 'r' toggles recording of the player's input (see input_log.h)
+		else if (serial_input == 'r' || serial_input == 'R')
+		{
+			input_log_enable(!input_log_enabled());
+		}
+
 		if (manual_mode && !manual_mode_printed)
 		{
 			move_terminal_cursor(10, 18);
@@ -190,6 +232,19 @@ void start_screen(void)
 			manual_mode_printed = !manual_mode_printed;
 		}
 
+		if (input_log_enabled() && !recording_printed)
+		{
+			move_terminal_cursor(10, 19);
+			printf_P(PSTR("Recording Input: ON"));
+			recording_printed = 1;
+		}
+		else if (!input_log_enabled() && recording_printed)
+		{
+			move_terminal_cursor(10, 19);
+			clear_to_end_of_line();
+			recording_printed = 0;
+		}
+
 		// Next check for any button presses
 		int8_t btn = button_pushed();
 		if (btn != NO_BUTTON_PUSHED)
@@ -205,6 +260,10 @@ void start_screen(void)
 			frame_number = (frame_number + 1) % 32;
 			last_screen_update = current_time;
 		}
+
+		// Send anything drawn this pass to the LED matrix
+		framebuffer_flush();
+		hal_idle();
 	}
 }
 
@@ -214,7 +273,8 @@ void new_game(void)
 
 	// Clear the serial terminal
 	clear_terminal();
-	print_game_terminal(1);
+	invalidate_game_terminal();
+	print_game_terminal();
 
 	uint8_t countdown_nums[4] = {3, 2, 1, 0};
 	uint8_t countdown_index = 0;
@@ -233,7 +293,11 @@ void new_game(void)
 			countdown_index++;
 			// Update the most recent time the notes were advance
 			last_advance_time = current_time;
+			// Make sure the number is showing before we start timing it
+			framebuffer_flush();
+			ledmatrix_flush_wait();
 		}
+		hal_idle();
 	}
 
 	// Initialise the game and display
@@ -247,118 +311,156 @@ void new_game(void)
 
 void play_game(void)
 {
-	uint32_t last_advance_time, current_time;
-	int8_t btn; // The button pushed
+	uint32_t next_advance_time, current_time;
+	InputEvent events[INPUT_BATCH_SIZE]; // Button and serial key inputs
+
+	// The notes advance five times per game_speed, on beat ticks counted
+	// by the timer 0 interrupt, so their timing doesn't depend on how long
+	// each pass of the loop takes. Tick n is due n periods after the start
+	// of the game - we keep track of that to see how late each one is.
+	uint16_t advance_period = game_speed / 5;
+	uint32_t start_time = start_beat_ticks(advance_period);
+	next_advance_time = start_time + advance_period;
+	input_log_start(game_time_to_fine_time(start_time), advance_period,
+			manual_mode);
+	if (manual_mode)
+	{
+		// Notes only advance on 'n' until manual mode is turned off
+		stop_beat_ticks();
+	}
+	late_ticks = 0;
+	skipped_ticks = 0;
 
-	last_advance_time = get_current_time();
+	// Take the lane keys straight from the serial input while playing, so
+	// that they are timestamped and queued with the buttons.
+	input_capture_serial_keys(1);
 
 	// We play the game until it's over
 	while (!is_game_over())
 	{
-		DDRC = 1;
-		// We need to check if any button has been pushed, this will be
-		// NO_BUTTON_PUSHED if no button has been pushed
-		// Checkout the function comment in `buttons.h` and the implementation
-		// in `buttons.c`.
-		btn = button_pushed();
-		char serial_input = -1;
-		if (serial_input_available())
-		{
-			serial_input = fgetc(stdin);
-		}
-
+		hal_gpio_set_outputs(GPIO_PORT_C, 1);
 		if (game_paused)
 		{
 			move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW - 3);
 			printf("Game Paused");
+			// Lane keys typed while paused are read and ignored below
+			input_capture_serial_keys(0);
 			while (game_paused)
 			{
-				PORTC = 1 | combo_LEDs;
+				hal_gpio_write(GPIO_PORT_C, 1 | combo_LEDs);
 				if (serial_input_available())
 				{
-					serial_input = fgetc(stdin);
-				}
-				if (serial_input == 'p' || serial_input == 'P')
-				{
-					game_paused = 0;
-					serial_input = -1;
+					char serial_input = fgetc(stdin);
+					if (serial_input == 'p' || serial_input == 'P')
+					{
+						game_paused = 0;
+						input_log_command(serial_input);
+					}
 				}
+				hal_idle();
 			}
 			//PORTC = 0 | combo_LEDs;
+			input_capture_serial_keys(1);
 			move_terminal_cursor(TERMINAL_INDENTATION, GAME_SCORE_ROW - 3);
 			clear_to_end_of_line();
 		}
 
-		if (serial_input == 'a' || serial_input == 'A')
-		{
-			btn = 3;
-		}
-		else if (serial_input == 's' || serial_input == 'S')
-		{
-			btn = 2;
-		}
-		else if (serial_input == 'd' || serial_input == 'D')
-		{
-			btn = 1;
-		}
-		else if (serial_input == 'f' || serial_input == 'F')
-		{
-			btn = 0;
-		}
-		else if (serial_input == 'm' || serial_input == 'M')
-		{
-			manual_mode = !manual_mode;
-			print_game_terminal(1);
-		}
-		else if (manual_mode && (serial_input == 'n' || serial_input == 'N'))
-		{
-			advance_note();
-		}
-
-		if (btn == BUTTON0_PUSHED)
-		{
-			// If button 0 play the lowest note (right lane)
-			play_note(0);
-		}
-		else if (btn == BUTTON1_PUSHED)
-		{
-			// If button 0 play the lowest note (right lane)
-			play_note(1);
-		}
-		else if (btn == BUTTON2_PUSHED)
-		{
-			// If button 0 play the lowest note (right lane)
-			play_note(2);
-		}
-		else if (btn == BUTTON3_PUSHED)
+		// Judge every input event waiting in the queue before drawing
+		// anything, so that a burst of presses isn't held up behind the
+		// rendering of each one. Only presses play notes, and each is judged
+		// at the time it actually happened. Button 0 (or 'f') plays the
+		// lowest note (right lane). Checkout the comments in `input.h`.
+		uint8_t num_events;
+		while ((num_events = input_drain_events(events, INPUT_BATCH_SIZE)) > 0)
 		{
-			// If button 0 play the lowest note (right lane)
-			play_note(3);
+			for (uint8_t i = 0; i < num_events; i++)
+			{
+				input_log_event(&events[i]);
+				if (events[i].pressed)
+				{
+					PROFILE_START(PROFILE_PLAY_NOTE);
+					play_note(events[i].lane, events[i].timestamp);
+					PROFILE_END(PROFILE_PLAY_NOTE);
+				}
+			}
 		}
 
-		if (serial_input == 'p' || serial_input == 'P')
+		// Then every waiting serial command. Anything typed after a pause
+		// is left until the game is resumed.
+		while (!game_paused && serial_input_available())
 		{
-			game_paused = 1;
+			char serial_input = fgetc(stdin);
+			if (serial_input == 'm' || serial_input == 'M')
+			{
+				input_log_command(serial_input);
+				manual_mode = !manual_mode;
+				if (manual_mode)
+				{
+					stop_beat_ticks();
+				}
+				else
+				{
+					// Start timing again from now
+					next_advance_time = start_beat_ticks(advance_period)
+							+ advance_period;
+				}
+			}
+			else if (manual_mode && (serial_input == 'n' || serial_input == 'N'))
+			{
+				input_log_command(serial_input);
+				advance_note();
+			}
+			else if (serial_input == 'p' || serial_input == 'P')
+			{
+				input_log_command(serial_input);
+				game_paused = 1;
+			}
+			else if (serial_input == 't' || serial_input == 'T')
+			{
+				// Only does anything in a PROFILE build (see profile.h)
+				profile_dump();
+			}
 		}
 
-		// Toggle advance_note control based on manual_mode flag.
-		if (!manual_mode)
+		// Advance the notes once for each beat tick since the last pass.
+		// Normally there is one at most, but if the loop has been held up we
+		// catch up with all of them at once. (There are no ticks in manual
+		// mode.)
+		uint8_t advances_due = take_beat_ticks();
+		if (advances_due > 0)
 		{
 			current_time = get_current_time();
-			if (current_time >= last_advance_time + game_speed / 5)
+			for (uint8_t i = 0; i < advances_due; i++)
 			{
-				// 200ms (0.2 second) has passed since the last time we advance the
-				// notes here, so update the advance the notes
-				advance_note();
-
-				// Update the most recent time the notes were advance
-				last_advance_time = current_time;
+				if (current_time != next_advance_time)
+				{
+					late_ticks++;
+				}
+				next_advance_time += advance_period;
 			}
+			skipped_ticks += advances_due - 1;
+			PROFILE_START(PROFILE_ADVANCE_NOTES);
+			advance_notes(advances_due);
+			PROFILE_END(PROFILE_ADVANCE_NOTES);
 		}
 
-		PORTC = 0 | combo_LEDs;
+		// Draw everything this pass changed, once, and send it to the LED
+		// matrix and terminal. This also finishes any terminal output that
+		// was put off while the serial link was busy.
+		PROFILE_START(PROFILE_UPDATE_GAME_DISPLAY);
+		update_game_display();
+		PROFILE_END(PROFILE_UPDATE_GAME_DISPLAY);
+		PROFILE_START(PROFILE_FRAMEBUFFER_FLUSH);
+		framebuffer_flush();
+		PROFILE_END(PROFILE_FRAMEBUFFER_FLUSH);
+
+		hal_gpio_write(GPIO_PORT_C, 0 | combo_LEDs);
+		hal_idle();
 	}
 	// We get here if the game is over.
+	stop_beat_ticks();
+	input_capture_serial_keys(0);
+	input_log_end(game_score, combo_count);
 }
 
 void handle_game_over()
@@ -367,6 +469,15 @@ void handle_game_over()
 	printf_P(PSTR("GAME OVER"));
 	move_terminal_cursor(10, 15);
 	printf_P(PSTR("Press a button or 's'/'S' to start a new game"));
+	move_terminal_cursor(10, 17);
+	printf_P(PSTR("Serial: %u bytes dropped, %u bytes deferred, "
+			"%u messages refused"), serial_dropped_bytes(),
+			serial_deferred_bytes(), serial_refused_messages());
+	move_terminal_cursor(10, 18);
+	printf_P(PSTR("Input events lost: %u"), input_overflow_count());
+	move_terminal_cursor(10, 19);
+	printf_P(PSTR("Beats: %u late, %u skipped while catching up"),
+			late_ticks, skipped_ticks);
 
 	// Do nothing until a button is pushed. Hint: 's'/'S' should also start a
 	// new game
@@ -376,6 +487,13 @@ void handle_game_over()
 		if (serial_input_available())
 		{
 			serial_input = fgetc(stdin);
+			if (serial_input == 't' || serial_input == 'T')
+			{
+				profile_dump();
+			}
 		}; // wait
+		// Keep a long final score scrolling
+		seven_seg_update();
+		hal_idle();
 	}
 }
@@ -3,34 +3,27 @@
  *
  * Author: Peter Sutton, Owen Harding
  *
- * timer 1 skeleton
+ * Audio on the buzzer, played with timer 1's PWM output OC1B. The timer
+ * settings for each note are precomputed in program memory (see assets.h),
+ * so changing note is just a matter of loading two registers.
  */
 
 #include "timer1.h"
-#include "game.h"
+#include "assets.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include <util/delay.h>
+#include "profile.h"
 
-// For a given frequency (Hz), return the clock period (in terms of the
-// number of clock cycles of a 1MHz clock)
-uint16_t freq_to_clock_period(uint16_t freq)
-{
-	return (1000000UL / freq); // UL makes the constant an unsigned long (32 bits)
-							   // and ensures we do 32 bit arithmetic, not 16
-}
-
-// Return the width of a pulse (in clock cycles) given a duty cycle (%) and
-// the period of the clock (measured in clock cycles)
-uint16_t duty_cycle_to_pulse_width(float dutycycle, uint16_t clockperiod)
-{
-	return (dutycycle * clockperiod) / 100;
-}
+// The note and duty cycle last asked for, and the settings to load into
+// timer 1 at the end of the current period. The interrupt which loads them
+// is only enabled while there is a new setting waiting, and for one period
+// after, to see the new top take effect.
+static uint8_t current_note;
+static DutyLevel current_duty;
+static volatile AudioSetting next_setting;
+static volatile uint8_t setting_waiting;
 
-uint16_t freq = 200; // Hz
-float dutycycle = 2; // %
-uint16_t clockperiod = 0;
-uint16_t pulsewidth = 0;
+volatile uint16_t timer1_top;
 
 /* Set up timer 1
  */
@@ -38,7 +31,17 @@ void init_timer1(void)
 {
 	TCNT1 = 0;
 
-	TIMSK1 |= (1 << OCIE1A);
+	// Start out silent
+	AudioSetting setting;
+	current_note = 0;
+	current_duty = DUTY_0;
+	asset_audio_setting(current_note, current_duty, &setting);
+	OCR1A = setting.top;
+	OCR1B = setting.compare;
+	timer1_top = setting.top;
+
+	// OC1B (pin D4) is the buzzer output
+	DDRD |= (1 << DDD4);
 
 	// Set up timer/counter 1 for Fast PWM, counting from 0 to the value in OCR1A
 	// before reseting to 0. Count at 1MHz (CLK/8).
@@ -50,47 +53,49 @@ void init_timer1(void)
 	// PWM output should now be happening - at the frequency and pulse width set above
 }
 
-ISR(TIMER1_COMPA_vect)
+void audio_play(uint8_t note, DutyLevel duty)
 {
-	DDRD = (1 << 4);
-
-	dutycycle = duty_percentage;
-
-	if (pulsewidth == 0)
+	if (note == current_note && duty == current_duty)
 	{
-		OCR1B = 0;
-	}
-	else
-	{
-		// The compare value is one less than the number of clock cycles in the pulse width
-		OCR1B = pulsewidth - 1;
+		return;
 	}
+	current_note = note;
+	current_duty = duty;
 
-	/* if (button_pressed_during_this_beat)
-	I'm pretty sure this should work because btn_pressed_during_this_beat reverts back to 0
-	at the starts of every beat, so the audio would only last for the duration of a beat
-	AND when a button is pressed. I can't figure out how to implement this though, it seems
-	to compile correctly but the LED matrix only shows 'ERR'. */
-	if (1)
-	{
-		// Work out the clock period and pulse width
-		clockperiod = freq_to_clock_period(freq);
-		pulsewidth = duty_cycle_to_pulse_width(dutycycle, clockperiod);
+	// Stop the interrupt while we change the waiting setting, then let it
+	// load the new one at the end of the current period. (The interrupt
+	// only ever clears its own enable bit, so it doesn't matter if it
+	// fires part way through clearing it here.)
+	TIMSK1 &= ~(1 << OCIE1A);
+	asset_audio_setting(note, duty, (AudioSetting *)&next_setting);
+	setting_waiting = 1;
+	TIMSK1 |= (1 << OCIE1A);
+}
 
-		if (pulsewidth == 0)
-		{
-			OCR1B = 0;
-		}
-		else
-		{
-			// The compare value is one less than the number of clock cycles in the pulse width
-			OCR1B = pulsewidth - 1;
-		}
+void audio_stop(void)
+{
+	audio_play(current_note, DUTY_0);
+}
 
-		OCR1A = clockperiod - 1;
+ISR(TIMER1_COMPA_vect)
+{
+	PROFILE_ISR_START();
+	// The timer has just reached the top of its count, and started a period
+	// with whatever was last loaded into OCR1A (which is double buffered).
+	timer1_top = OCR1A;
+
+	// Load the new period and pulse width, which take effect from the next
+	// period. Once they have, nothing more to do until the setting changes
+	// again.
+	if (setting_waiting)
+	{
+		OCR1A = next_setting.top;
+		OCR1B = next_setting.compare;
+		setting_waiting = 0;
 	}
 	else
 	{
-		DDRD = 8;
+		TIMSK1 &= ~(1 << OCIE1A);
 	}
-}
\ No newline at end of file
+	PROFILE_ISR_END(PROFILE_TIMER1_COMPA);
+}
@@ -3,22 +3,35 @@
  *
  * Author: Peter Sutton, Owen Harding
  *
- * timer 1 skeleton
+ * Audio on the buzzer (pin D4), played with timer 1.
  */
 
 #ifndef TIMER1_H_
 #define TIMER1_H_
 
 #include <stdint.h>
+#include "assets.h"
 
-/* Set up our timer 
+/* Set up our timer. The buzzer starts out silent.
  */
 void init_timer1(void);
 
-uint16_t freq_to_clock_period(uint16_t freq);
+/* Play the given note (0 to NUM_NOTES - 1, one for each lane) at the given
+ * duty cycle. The change takes effect at the end of the current period, and
+ * nothing is done if the note and duty cycle are already playing.
+ */
+void audio_play(uint8_t note, DutyLevel duty);
 
-uint16_t duty_cycle_to_pulse_width(float dutycycle, uint16_t clockperiod);
+/* Silence the buzzer (the current note at DUTY_0).
+ */
+void audio_stop(void);
 
-uint16_t freq;
+/* Timer 1's top (OCR1A) for the period it is counting now - it counts at
+ * 1MHz (CLK/8) from 0 to this, then starts again. A new top only takes
+ * effect at the end of the period it is loaded in. Only changed by the
+ * timer 1 interrupt handler, so other interrupt handlers can read it
+ * without anything changing under them.
+ */
+extern volatile uint16_t timer1_top;
 
 #endif /* TIMER1_H_ */
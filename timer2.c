@@ -9,10 +9,9 @@
 #include "timer2.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
-#include "game.h"
-
-/* Seven segment display values */
-uint8_t seven_seg_data[11] = {63, 6, 91, 79, 102, 109, 125, 7, 127, 111, 64};
+#include "assets.h"
+#include "timer0.h"
+#include "profile.h"
 
 volatile uint8_t stopwatch_timing = 0;
 
@@ -21,8 +20,8 @@ volatile uint8_t stopwatch_timing = 0;
 */
 volatile uint8_t digits_displayed = 0;
 
-/* Time value - we count hundredths of seconds,
-** i.e. increment the count every 10ms.
+/* Time value - we count thousandths of seconds,
+** i.e. increment the count every 1ms.
 */
 volatile uint16_t count = 0;
 
@@ -31,6 +30,43 @@ volatile uint16_t count = 0;
 */
 volatile uint8_t seven_seg_cc = 0;
 
+/* What the seven segment display shows, as segment patterns ready to
+** write to PORTA (without the digit select bit). If there are more than
+** two, they scroll across the display; the last is a blank gap before the
+** start comes round again. Only used by the main loop.
+*/
+#define SEVEN_SEG_TEXT_LENGTH 7		/* Enough for "-32768" and the gap */
+static uint8_t text_length;
+static uint8_t text_segments[SEVEN_SEG_TEXT_LENGTH];
+
+/* Milliseconds each scroll position is shown for */
+#define SEVEN_SEG_SCROLL_MS 400
+
+/* First text position on the display (the left digit), and when it last
+** moved.
+*/
+static uint8_t scroll_position;
+static uint16_t last_scroll_time;
+
+/* The two patterns on the display: [0] for the left digit, [1] for the
+** right.
+*/
+typedef struct
+{
+	uint8_t segments[2];
+} SevenSegFrame;
+
+/* Frames are handed from the main loop to the interrupt handler through
+** three buffers. frame_ready is the latest complete frame, written only by
+** show_frame(), and frame_shown is the frame being displayed, written only
+** by the interrupt handler when a new display frame starts. A new frame is
+** always written into the third buffer, so the handler never sees a half
+** written frame and the two digits never show different frames.
+*/
+static volatile SevenSegFrame frames[3];
+static volatile uint8_t frame_ready;
+static volatile uint8_t frame_shown;
+
 /* Set up timer 2
  */
 void init_timer2(void)
@@ -38,13 +74,13 @@ void init_timer2(void)
 	DDRA = 0xff;
 
 	TCNT2 = 0;
-	/* Set up timer/counter 1 so that we get an
-	** interrupt 100 times per second, i.e. every
-	** 10 milliseconds.
+	/* Set up timer/counter 2 so that we get an
+	** interrupt 1000 times per second, i.e. every
+	** millisecond, so each digit is lit 500 times per second.
 	*/
-	OCR2A = 9999;						 /* Clock divided by 8 - count for 10000 cycles */
-	TCCR2A = 0;							 /* CTC mode */
-	TCCR2B = (1 << WGM22) | (1 << CS21); /* Divide clock by 8 */
+	OCR2A = 124;				/* Clock divided by 64 - count for 125 cycles */
+	TCCR2A = (1 << WGM21);		/* CTC mode */
+	TCCR2B = (1 << CS22);		/* Divide clock by 64 */
 
 	/* Enable interrupt on timer on output compare match
 	 */
@@ -53,66 +89,140 @@ void init_timer2(void)
 	/* Ensure interrupt flag is cleared */
 	TIFR2 = (1 << OCF2A);
 
+	seven_seg_show_score(0);
 	stopwatch_timing ^= 1;
 	digits_displayed = 1;
 }
 
-ISR(TIMER2_COMPA_vect)
+/* Hands the two text positions from scroll_position on to the interrupt
+** handler.
+*/
+static void show_frame(void)
 {
-	uint8_t ones_digit, tens_digit;
-	/* If the stopwatch is running then increment time.
-	** If we've reached 1000, then wrap this around to 0.
+	/* Pick the buffer the interrupt handler isn't showing and won't pick
+	** up next. (If it picks up frame_ready while we're looking, that's
+	** still not this one.)
 	*/
-	if (stopwatch_timing)
+	uint8_t next = 0;
+	while (next == frame_ready || next == frame_shown)
 	{
-		count++;
-		if (count == 1000)
+		next++;
+	}
+	uint8_t right = scroll_position + 1;
+	if (right == text_length)
+	{
+		right = 0;
+	}
+	frames[next].segments[0] = text_segments[scroll_position];
+	frames[next].segments[1] = text_segments[right];
+	frame_ready = next;
+}
+
+void seven_seg_show_score(int16_t score)
+{
+	uint16_t magnitude = score < 0 ? -(uint16_t)score : score;
+	if (score > -10 && score < 100)
+	{
+		/* Fits - a blank or minus sign in the left digit for a single
+		** digit
+		*/
+		text_length = 2;
+		if (magnitude >= 10)
 		{
-			count = 0;
+			text_segments[0] = asset_seven_seg(magnitude / 10);
+		}
+		else
+		{
+			text_segments[0] = score < 0 ? asset_seven_seg(SEVEN_SEG_MINUS) : 0;
 		}
+		text_segments[1] = asset_seven_seg(magnitude % 10);
 	}
-
-	// Calculate the ones and tens digits
-	if (game_score < -9)
+	else
+	{
+		/* Too long - scroll the whole number, followed by a gap */
+		uint8_t digits[5];
+		uint8_t num_digits = 0;
+		do
+		{
+			digits[num_digits++] = magnitude % 10;
+			magnitude /= 10;
+		} while (magnitude > 0);
+		
+		uint8_t length = 0;
+		if (score < 0)
+		{
+			text_segments[length++] = asset_seven_seg(SEVEN_SEG_MINUS);
+		}
+		while (num_digits > 0)
+		{
+			text_segments[length++] = asset_seven_seg(digits[--num_digits]);
+		}
+		text_segments[length++] = 0;
+		text_length = length;
+	}
+	
+	/* Carry on scrolling from the same place if the text is still long
+	** enough
+	*/
+	if (text_length == 2 || scroll_position >= text_length)
 	{
-		ones_digit = 10; // Display '-' in the ones digit
-		tens_digit = 10; // Display '-' in the tens digit
+		scroll_position = 0;
 	}
-	else if (game_score < 0)
+	show_frame();
+}
+
+void seven_seg_update(void)
+{
+	if (text_length <= 2)
 	{
-		ones_digit = -(game_score % 10);
-		tens_digit = 10; // Display '-' in the tens digit
+		return;
 	}
-	else if (game_score < 100)
+	uint16_t now = get_current_time();
+	if ((uint16_t)(now - last_scroll_time) >= SEVEN_SEG_SCROLL_MS)
 	{
-		ones_digit = game_score % 10;
-		tens_digit = (game_score / 10) % 10;
+		last_scroll_time = now;
+		scroll_position++;
+		if (scroll_position == text_length)
+		{
+			scroll_position = 0;
+		}
+		show_frame();
 	}
-	else
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+	PROFILE_ISR_START();
+	/* If the stopwatch is running then increment time.
+	** If we've reached 1000, then wrap this around to 0.
+	*/
+	if (stopwatch_timing)
 	{
-		ones_digit = 0;
-		tens_digit = 0;
+		count++;
+		if (count == 1000)
+		{
+			count = 0;
+		}
 	}
 
 	// Toggle the seven-segment display digit
 	seven_seg_cc ^= 1;
 
+	if (seven_seg_cc == 0)
+	{
+		// A new frame (right digit then left) - pick up the latest one
+		frame_shown = frame_ready;
+	}
+
 	if (digits_displayed)
 	{
-		if (seven_seg_cc == 0)
-		{
-			// Display the rightmost digit (tenths of seconds)
-			PORTA = seven_seg_data[ones_digit] | (seven_seg_cc ? 0x80 : 0);
-		}
-		else
-		{
-			// Display the leftmost digit (seconds + decimal point)
-			PORTA = tens_digit ? (seven_seg_data[tens_digit] | (seven_seg_cc ? 0x80 : 0)) : (seven_seg_cc ? 0x80 : 0);
-		}
+		PORTA = frames[frame_shown].segments[seven_seg_cc ? 0 : 1]
+				| (seven_seg_cc ? 0x80 : 0);
 	}
 	else
 	{
 		// No digits displayed, display is blank
 		PORTA = 0;
 	}
+	PROFILE_ISR_END(PROFILE_TIMER2_COMPA);
 }
\ No newline at end of file
@@ -15,5 +15,18 @@
  */
 void init_timer2(void);
 
+/* Show the given score on the seven segment display. The segment patterns
+** are worked out here, once, and handed to the interrupt handler which
+** multiplexes the display. Scores from -9 to 99 fit on the two digits;
+** anything else scrolls across them, moved along by seven_seg_update().
+*/
+void seven_seg_show_score(int16_t score);
+
+/* Scroll a score which doesn't fit on to its next position, every 400ms
+** of game time. Called from the main loop; does nothing for scores that
+** fit.
+*/
+void seven_seg_update(void);
+
 
 #endif /* TIMER2_H_ */
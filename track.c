@@ -0,0 +1,100 @@
+/*
+ * track.c
+ *
+ * Author: Owen Harding
+ *
+ * Decoder for the song. See track.h for the encoding.
+ */
+
+#include "track.h"
+#include <stdint.h>
+#include "assets.h"
+
+uint16_t track_length(void)
+{
+	uint16_t position = 0;
+	uint16_t length = 0;
+	while (1)
+	{
+		uint8_t byte = asset_track_byte(position);
+		if (byte != TRACK_ESCAPE)
+		{
+			length++;
+			position++;
+			continue;
+		}
+		uint8_t count = asset_track_byte(position + 1);
+		if (count == TRACK_END)
+		{
+			return length;
+		}
+		// Rests and repeats both count for that many rows.
+		length += count & ~TRACK_REPEAT;
+		position += 2;
+	}
+}
+
+void track_reader_start(TrackReader *reader)
+{
+	reader->position = 0;
+	reader->index = 0;
+	reader->run_row = 0;
+	reader->run_length = 0;
+}
+
+uint8_t track_reader_next(TrackReader *reader)
+{
+	reader->index++;
+	if (reader->run_length == 0)
+	{
+		uint8_t byte = asset_track_byte(reader->position);
+		if (byte != TRACK_ESCAPE)
+		{
+			// A single row. Remember it in case a repeat follows.
+			reader->position++;
+			reader->run_row = byte;
+			return byte;
+		}
+
+		uint8_t count = asset_track_byte(reader->position + 1);
+		if (count == TRACK_END)
+		{
+			// Stay on the end code so we keep returning rests.
+			return 0;
+		}
+		reader->position += 2;
+		if (count & TRACK_REPEAT)
+		{
+			reader->run_length = count & ~TRACK_REPEAT;
+		}
+		else
+		{
+			reader->run_row = 0;
+			reader->run_length = count;
+		}
+	}
+	reader->run_length--;
+	return reader->run_row;
+}
+
+void track_reader_skip_rests(TrackReader *reader)
+{
+	// Skip what's left of a run of rests we are part way through.
+	if (reader->run_row == 0)
+	{
+		reader->index += reader->run_length;
+		reader->run_length = 0;
+	}
+	// Then any runs of rests that come next.
+	while (reader->run_length == 0
+			&& asset_track_byte(reader->position) == TRACK_ESCAPE)
+	{
+		uint8_t count = asset_track_byte(reader->position + 1);
+		if (count == TRACK_END || (count & TRACK_REPEAT))
+		{
+			break;
+		}
+		reader->index += count;
+		reader->position += 2;
+	}
+}
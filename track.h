@@ -0,0 +1,57 @@
+/*
+ * track.h
+ *
+ * Author: Owen Harding
+ *
+ * The song is stored in flash in a compact encoding and read back one
+ * row at a time as it plays, so its length is limited by flash rather
+ * than by RAM.
+ *
+ * Each row is one byte: the right nybble has the short notes and the
+ * left nybble the long notes, one bit per lane. In the encoded track a
+ * non-zero byte is a single row. A zero byte starts a two byte code:
+ *   0x00 n        - n rows of rests (n from 1 to 127)
+ *   0x00 0x80|n   - the row before repeated n more times (n from 1 to 127)
+ *   0x00 0x00     - the end of the track
+ */
+
+#ifndef TRACK_H_
+#define TRACK_H_
+
+#include <stdint.h>
+
+// Bytes of the encoding, and macros for writing an encoded track.
+#define TRACK_ESCAPE 0x00
+#define TRACK_END 0x00
+#define TRACK_REPEAT 0x80
+
+#define REST(n) TRACK_ESCAPE, (n)
+#define REPEAT(n) TRACK_ESCAPE, (TRACK_REPEAT | (n))
+#define END_OF_TRACK TRACK_ESCAPE, TRACK_END
+
+// Reads the rows of the track in order. Any number of readers can be
+// reading the track at once, each at its own position.
+typedef struct
+{
+	uint16_t position;			// offset of the next byte of the encoded track
+	uint16_t index;				// row number of the next row to be read
+	uint8_t run_row;			// row being repeated (0 for rests)
+	uint8_t run_length;			// repeats of run_row still to be read
+} TrackReader;
+
+// Returns the number of rows in the track.
+uint16_t track_length(void);
+
+// Sets the reader back to the first row of the track.
+void track_reader_start(TrackReader *reader);
+
+// Returns the next row of the track. Past the end of the track every
+// row is a rest.
+uint8_t track_reader_next(TrackReader *reader);
+
+// Moves the reader past any rests before the next row with notes in it,
+// without reading them a row at a time. Does nothing at the end of the
+// track.
+void track_reader_skip_rests(TrackReader *reader);
+
+#endif /* TRACK_H_ */